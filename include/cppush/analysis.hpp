@@ -0,0 +1,39 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "opcode.hpp"
+#include "program.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace cppush {
+
+// instructions that skip or repeat items on the exec stack
+bool is_exec_instruction(Opcode opcode);
+
+// Whether running each of program's blocks may skip or repeat code after the
+// block ends, because it or a block it contains has an exec instruction
+std::vector<bool> redirecting_blocks(const Program& program);
+
+// Whether program is straight-line number code: literals, inputs, blocks and
+// number instructions (with their superinstructions and unchecked variants)
+// only, and no recursive blocks. Such a program takes the same path on every
+// run, so the number stack depth before each instruction is known exactly
+bool is_straight_line(const Program& program);
+
+// Lower bound on the number stack depth before each instruction in
+// Program::code, assuming the program runs on an empty number stack with at
+// least `inputs` inputs. Depths are only tracked through straight-line code:
+// they stay at 0 for the rest of a block after an exec instruction or a
+// block that contains one
+std::vector<std::size_t> min_depths(const Program& program, std::size_t inputs = 0);
+
+// Replace number instructions with their unchecked variants wherever
+// min_depths proves underflow impossible. The program must then be run with
+// an empty number stack and at least `inputs` inputs
+void elide_checks(Program& program, std::size_t inputs = 0);
+
+} // namespace cppush
+
+#endif // ANALYSIS_H
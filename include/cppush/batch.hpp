@@ -0,0 +1,167 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "frame_stack.hpp"
+#include "program.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace cppush {
+
+// Runs one Program over several fitness cases at once. Each number stack item
+// holds one value per case (lane), so a single dispatch does the work of
+// every lane and the arithmetic can be vectorised.
+//
+// Lanes run as groups sharing an exec stack. When exec_if disagrees between
+// the lanes of a group, the group splits in two, each masked to its lanes.
+// Both halves run their branch and then merge back into one group if their
+// stacks have the same shape at the instruction following the if.
+class BatchState {
+public:
+	static constexpr std::size_t lanes = 8;
+	using Lanes = std::array<double, lanes>;
+	using Mask = std::uint32_t; // one bit per lane
+	static_assert(lanes <= 32, "Mask must have a bit for every lane");
+
+	// whether every instruction in program can run batched
+	static bool supports(const Program& program);
+
+	// stop a lane once it has charged this many instructions, where State
+	// would. see FrameStack
+	void set_effort_limit(std::size_t limit) { effort_limit = limit; }
+
+	// inputs[i][lane] is input i of the case in that lane
+	void run(const Program& program, const std::vector<Lanes>& inputs);
+
+	// top of a lane's number stack after run(). NaN if empty
+	double top_number(std::size_t lane) const;
+	// whether the last run() stopped the lane for going over the effort limit
+	bool cut_off(std::size_t lane) const { return cut_lanes & (Mask(1) << lane); }
+	// number of lane groups the last run() finished with
+	std::size_t groups() const { return finished.size(); }
+
+private:
+	// A stack whose bottom can be shared by the groups a split made. Items are
+	// only copied out of the shared base once an instruction reaches them, so
+	// splitting and merging cost what the branches touched, not the whole stack
+	template <typename T>
+	class SharedStack {
+	public:
+		std::size_t size() const { return base_size + items.size(); }
+		bool empty() const { return size() == 0; }
+		void push_back(T item) { items.push_back(item); }
+		void pop_back() {
+			if (items.empty()) {
+				--base_size;
+			} else {
+				items.pop_back();
+			}
+		}
+		T& back() {
+			if (items.empty()) {
+				items.push_back((*base)[--base_size]);
+			}
+			return items.back();
+		}
+		const T& top() const { return items.empty() ? (*base)[base_size - 1] : items.back(); }
+
+		// move every item into the base, so copies of this stack share them
+		void share() {
+			if (base && base.use_count() == 1) {
+				base->resize(base_size);
+			} else {
+				auto shared = std::make_shared<std::vector<T>>();
+				if (base) {
+					shared->assign(base->begin(), base->begin() + base_size);
+				}
+				base = std::move(shared);
+			}
+			base->insert(base->end(), items.begin(), items.end());
+			items.clear();
+			base_size = base->size();
+		}
+
+		// call f(item, other's item) for every item that may differ between
+		// the two. both stacks must be the same size
+		template <typename F>
+		void blend(SharedStack& other, F f) {
+			std::size_t common = base == other.base ? std::min(base_size, other.base_size) : 0;
+			own_from(common);
+			other.own_from(common);
+			for (std::size_t i = 0; i < items.size(); ++i) {
+				f(items[i], other.items[i]);
+			}
+		}
+
+	private:
+		// copy the base items at depth and above out of the base
+		void own_from(std::size_t depth) {
+			if (depth < base_size) {
+				items.insert(items.begin(), base->begin() + depth, base->begin() + base_size);
+				base_size = depth;
+			}
+		}
+
+		std::shared_ptr<std::vector<T>> base;
+		std::size_t base_size = 0; // items of base that are in this stack
+		std::vector<T> items; // above the base
+	};
+
+	struct Group {
+		Mask mask; // lanes this group is responsible for
+		FrameStack frames;
+		SharedStack<Lanes> number_stack;
+		SharedStack<Mask> bool_stack;
+	};
+
+	// the groups a split made, running until they reach join, the
+	// continuation after the exec_if. once none are left running, the arrivals
+	// merge and carry on in the parent region
+	struct Region {
+		FrameStack join;
+		std::size_t parent;
+		std::size_t running; // groups, or child regions, yet to arrive
+		std::vector<Group> arrived;
+	};
+	// no join: groups run until their exec stack is empty
+	static constexpr std::size_t top = static_cast<std::size_t>(-1);
+
+	// a group ready to run in a region
+	struct Task {
+		Group group;
+		std::size_t region;
+	};
+
+	// run group until its exec stack is empty or matches join. returns the
+	// lanes taking the branch if an exec_if diverges, otherwise 0
+	Mask execute(Group& group, const FrameStack* join);
+	void split(Group group, Mask taken, std::size_t region);
+	void arrive(Group group, std::size_t region);
+
+	std::size_t effort_limit = std::numeric_limits<std::size_t>::max();
+	const Program* program = nullptr;
+	const std::vector<Lanes>* inputs = nullptr;
+	Mask cut_lanes = 0;
+	std::vector<Group> finished;
+	// splits are handled through a worklist rather than recursion, as every
+	// divergence would otherwise nest deeper on the C++ stack
+	std::vector<Task> work;
+	std::vector<Region> regions;
+	std::vector<std::size_t> free_regions;
+};
+
+// Top of the number stack (NaN if empty) after running program on each case,
+// stopping cases that go over effort_limit. Cases run BatchState::lanes at a
+// time when the program and inputs allow it, otherwise one at a time on a State
+std::vector<double> run_cases(const Program& program, const std::vector<std::vector<double>>& cases,
+	std::size_t effort_limit = std::numeric_limits<std::size_t>::max());
+
+} // namespace cppush
+
+#endif // BATCH_H
@@ -0,0 +1,56 @@
+#ifndef BITSLICE_H
+#define BITSLICE_H
+
+#include "frame_stack.hpp"
+#include "program.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace cppush {
+
+// Runs one Program over 64 boolean fitness cases at once. Each bool stack item
+// is a word with one bit per case, so a single and/or/xor does the work of
+// every case.
+//
+// All cases share one exec stack, so only programs whose control flow cannot
+// depend on the data run this way: bool inputs and ops, blocks, exec_dup and
+// exec_pop.
+class BitsliceState {
+public:
+	static constexpr std::size_t lanes = 64;
+	using Word = std::uint64_t; // one bit per case
+
+	// whether every instruction in program can run bitsliced
+	static bool supports(const Program& program);
+
+	// charged like State::set_effort_limit, on the shared exec stack
+	void set_effort_limit(std::size_t limit) { frames.set_effort_limit(limit); }
+	// whether the last run went over the effort limit. every case runs the
+	// same instructions, so they're all cut off together
+	bool cut_off() const { return frames.cut_off(); }
+
+	// bit c of inputs[i] is input i of case c
+	void run(const Program& program, const std::vector<Word>& inputs);
+
+	const std::vector<Word>& get_bool_stack() const { return bool_stack; }
+
+private:
+	FrameStack frames;
+	std::vector<Word> bool_stack;
+};
+
+// Top of the bool stack for every row of the truth table over the given
+// number of inputs, where input i of row r is bit i of r. Row r is bit r % 64
+// of word r / 64. Rows that end with an empty bool stack read as false, and
+// rows stop once they go over effort_limit.
+// Rows run BitsliceState::lanes at a time when the program allows it,
+// otherwise one at a time on a State
+std::vector<BitsliceState::Word> run_truth_table(const Program& program, std::size_t inputs,
+	std::size_t effort_limit = std::numeric_limits<std::size_t>::max());
+
+} // namespace cppush
+
+#endif // BITSLICE_H
@@ -0,0 +1,89 @@
+#ifndef BOOLEAN_OPS_H
+#define BOOLEAN_OPS_H
+
+namespace cppush {
+
+// Bool instructions, for any state type with get_stack, push and pop
+
+template <typename State>
+unsigned bool_and(State& state) {
+	auto& stack = state.template get_stack<bool>();
+	if (stack.size() >= 2) {
+		bool top = state.template pop<bool>();
+		stack.back() = stack.back() && top;
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned bool_or(State& state) {
+	auto& stack = state.template get_stack<bool>();
+	if (stack.size() >= 2) {
+		bool top = state.template pop<bool>();
+		stack.back() = stack.back() || top;
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned bool_not(State& state) {
+	auto& stack = state.template get_stack<bool>();
+	if (stack.size() > 0) {
+		stack.back() = !stack.back();
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned bool_nand(State& state) {
+	auto& stack = state.template get_stack<bool>();
+	if (stack.size() >= 2) {
+		bool top = state.template pop<bool>();
+		stack.back() = !(stack.back() && top);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned bool_nor(State& state) {
+	auto& stack = state.template get_stack<bool>();
+	if (stack.size() >= 2) {
+		bool top = state.template pop<bool>();
+		stack.back() = !(stack.back() || top);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned bool_xor(State& state) {
+	auto& stack = state.template get_stack<bool>();
+	if (stack.size() >= 2) {
+		bool top = state.template pop<bool>();
+		stack.back() = stack.back() != top;
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned bool_invert_first_then_and(State& state) {
+	auto& stack = state.template get_stack<bool>();
+	if (stack.size() >= 2) {
+		bool top = state.template pop<bool>();
+		stack.back() = stack.back() && !top;
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned bool_invert_second_then_and(State& state) {
+	auto& stack = state.template get_stack<bool>();
+	if (stack.size() >= 2) {
+		bool top = state.template pop<bool>();
+		stack.back() = !stack.back() && top;
+	}
+	return 1;
+}
+
+} // namespace cppush
+
+#endif // BOOLEAN_OPS_H
@@ -0,0 +1,41 @@
+#ifndef CLOSURES_H
+#define CLOSURES_H
+
+#include "program.hpp"
+#include "state_fwd.hpp"
+
+#include <vector>
+
+namespace cppush {
+
+
+// A Program compiled once into pre-bound closures: each instruction becomes a
+// function pointer with its literal value or input index already resolved, so
+// running it involves no opcode decode and no constant pool lookups. Blocks
+// that can't redirect the exec stack call their contents directly instead of
+// pushing a frame. Portable, unlike NativeProgram
+class ClosureProgram {
+public:
+	explicit ClosureProgram(const Program& program);
+	~ClosureProgram();
+	// closures point into each other, so moving is fine but copying isn't
+	ClosureProgram(ClosureProgram&& other) noexcept;
+	ClosureProgram& operator=(ClosureProgram&& other) noexcept;
+	ClosureProgram(const ClosureProgram&) = delete;
+	ClosureProgram& operator=(const ClosureProgram&) = delete;
+
+	// same as state.run(program, inputs) on the compiled program
+	void run(State& state, const std::vector<double>& inputs = {}) const;
+
+	// defined in closures.cpp
+	struct Closure;
+	struct Machine;
+
+private:
+	// one per instruction, laid out like Program::code, then one for the main block
+	std::vector<Closure> closures;
+};
+
+} // namespace cppush
+
+#endif // CLOSURES_H
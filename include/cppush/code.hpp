@@ -1,12 +1,13 @@
 #ifndef CODE_H
 #define CODE_H
 
+#include "state_fwd.hpp"
+
 #include <memory>
 #include <vector>
 
 namespace cppush {
 
-class State;
 using Op = unsigned (*)(State&);
 
 class Code {
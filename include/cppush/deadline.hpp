@@ -0,0 +1,32 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <chrono>
+#include <ctime>
+
+namespace cppush {
+
+// A monotonic clock that is cheap to read, for checking deadlines often.
+// CLOCK_MONOTONIC_COARSE is read from the vDSO without a syscall, at the cost
+// of only ticking every few milliseconds. Elsewhere it's steady_clock
+struct CoarseClock {
+	using duration = std::chrono::nanoseconds;
+	using rep = duration::rep;
+	using period = duration::period;
+	using time_point = std::chrono::time_point<CoarseClock>;
+	static constexpr bool is_steady = true;
+
+	static time_point now() noexcept {
+#ifdef CLOCK_MONOTONIC_COARSE
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+		return time_point(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+#else
+		return time_point(std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch()));
+#endif
+	}
+};
+
+} // namespace cppush
+
+#endif // DEADLINE_H
@@ -0,0 +1,159 @@
+#ifndef FRAME_STACK_H
+#define FRAME_STACK_H
+
+#include "deadline.hpp"
+#include "program.hpp"
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace cppush {
+
+// Exec stack for running a Program. Each frame is a continuation: the
+// unexecuted remainder of a block. Entering a block pushes one frame instead
+// of copying the block's contents. Item is what the program was compiled to;
+// Bytecode for a Program itself.
+//
+// Effort is charged when a frame is pushed, for every item in it, so a
+// budget costs one check per block entered instead of one per instruction.
+// Going over the limit empties the stack, which ends the run. A deadline is
+// checked the same way, once the effort since the last check reaches
+// check_every, so neither limit adds work between checks
+template <typename Item>
+class BasicFrameStack {
+public:
+	// clear the stack and push the program's main block
+	void start(const Program& program) {
+		clear();
+		if (!program.blocks.empty()) {
+			push(program, program.blocks[0]);
+		}
+	}
+
+	// also resets the effort spent and whether the run timed out
+	void clear() {
+		frames.clear();
+		effort = 0;
+		timed_out_ = false;
+		check_at = next_check();
+	}
+	bool empty() const { return frames.empty(); }
+	bool has_two_items() const {
+		return frames.size() >= 2 || (!frames.empty() && frames.back().end - frames.back().pc >= 2);
+	}
+
+	// same continuation, so the same instructions will run from here on
+	bool operator==(const BasicFrameStack& other) const { return frames == other.frames; }
+	bool operator!=(const BasicFrameStack& other) const { return !(*this == other); }
+
+	// pop the next instruction. the stack must not be empty
+	const Item& next() {
+		Frame& frame = frames.back();
+		const Item& item = *frame.pc++;
+		// drop finished frames immediately so every frame on the stack has a next item
+		if (frame.pc == frame.end) {
+			frames.pop_back();
+		}
+		return item;
+	}
+
+	void push(const Program& program, Block block) {
+		const Bytecode* code = program.code.data();
+		push(code + block.begin, code + block.end);
+	}
+
+	void push(const Item* begin, const Item* end) {
+		if (begin != end && charge(static_cast<std::size_t>(end - begin))) {
+			frames.push_back({begin, end});
+		}
+	}
+
+	// charge for items run without a frame of their own, e.g. an inlined
+	// block. false, with the stack emptied, if that goes over the limit
+	bool charge(std::size_t items) {
+		effort += items;
+		if (effort > check_at && !within_limits()) {
+			frames.clear();
+			return false;
+		}
+		return true;
+	}
+
+	std::size_t get_effort() const { return effort; }
+	bool timed_out() const { return timed_out_; }
+	// out of effort or time
+	bool cut_off() const { return effort > effort_limit || timed_out_; }
+
+	// both take effect from the next clear() or start()
+	void set_effort_limit(std::size_t limit) { effort_limit = limit; }
+	void set_deadline(CoarseClock::time_point deadline, std::size_t check_every) {
+		this->deadline = deadline;
+		this->check_every = check_every;
+	}
+
+	// exec_dup: repeat the next item
+	void dup_next() {
+		if (!frames.empty()) {
+			const Item* next = frames.back().pc;
+			push(next, next + 1);
+		}
+	}
+
+	// exec_if when true: run the next item but skip the one after it.
+	// requires has_two_items()
+	void skip_second() {
+		const Item* next = frames.back().pc;
+		pop_next();
+		pop_next();
+		push(next, next + 1);
+	}
+
+	// exec_pop: skip the next item
+	void pop_next() {
+		if (!frames.empty()) {
+			Frame& top = frames.back();
+			if (++top.pc == top.end) {
+				frames.pop_back();
+			}
+		}
+	}
+
+private:
+	struct Frame {
+		const Item* pc;
+		const Item* end;
+
+		bool operator==(const Frame& other) const { return pc == other.pc && end == other.end; }
+	};
+	std::vector<Frame> frames;
+	// the next effort at which charge() checks the limits
+	std::size_t next_check() const {
+		return check_every < effort_limit - effort ? effort + check_every : effort_limit;
+	}
+
+	bool within_limits() {
+		if (effort > effort_limit) {
+			return false;
+		}
+		if (CoarseClock::now() > deadline) {
+			timed_out_ = true;
+			return false;
+		}
+		check_at = next_check();
+		return true;
+	}
+
+	std::size_t effort = 0; // items charged since the stack was last cleared
+	std::size_t effort_limit = std::numeric_limits<std::size_t>::max();
+	std::size_t check_at = std::numeric_limits<std::size_t>::max();
+	CoarseClock::time_point deadline = CoarseClock::time_point::max();
+	std::size_t check_every = std::numeric_limits<std::size_t>::max();
+	bool timed_out_ = false;
+};
+
+using FrameStack = BasicFrameStack<Bytecode>;
+
+} // namespace cppush
+
+#endif // FRAME_STACK_H
@@ -0,0 +1,44 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include "opcode.hpp"
+#include "program.hpp"
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace cppush {
+
+// one opcode standing in for a common sequence. it takes the arg of the
+// sequence's leading literal/input
+struct Superinstruction {
+	Opcode opcode;
+	std::vector<Opcode> pattern;
+};
+
+// every superinstruction State::run understands
+const std::vector<Superinstruction>& superinstructions();
+
+// counts opcode pairs and triples within blocks over a set of programs
+class NgramProfile {
+public:
+	void add(const Program& program);
+	std::size_t count(const std::vector<Opcode>& ngram) const;
+
+private:
+	std::map<std::vector<Opcode>, std::size_t> counts;
+};
+
+// the (at most max) superinstructions whose patterns were seen most often in profile
+std::vector<Opcode> select_superinstructions(const NgramProfile& profile, std::size_t max);
+
+// replace sequences matching the enabled superinstructions. longer patterns are
+// preferred. an immediate literal that fuses moves into the number pool, unless
+// the pool is full
+void fuse(Program& program);
+void fuse(Program& program, const std::vector<Opcode>& enabled);
+
+} // namespace cppush
+
+#endif // FUSION_H
@@ -0,0 +1,31 @@
+#ifndef GENOME_H
+#define GENOME_H
+
+#include "opcode.hpp"
+#include "program.hpp"
+
+#include <vector>
+
+namespace cppush {
+
+// linear plushy representation of a program
+struct Gene {
+	enum class Type {
+		Instruction, Literal, Close
+	};
+	Type type;
+	Bytecode instruction{}; // used by Type::Instruction
+	double literal = 0; // used by Type::Literal
+};
+using Genome = std::vector<Gene>;
+
+// number of blocks opened by an instruction in a genome
+unsigned parens_required(Opcode opcode);
+
+// translate a genome to bytecode in a single pass. unclosed blocks are closed
+// at the end of the genome and identical constants share a pool entry
+Program genome_to_program(const Genome& genome);
+
+} // namespace cppush
+
+#endif // GENOME_H
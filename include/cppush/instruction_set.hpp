@@ -1,50 +1,97 @@
 #ifndef INSTRUCTION_SET_H
 #define INSTRUCTION_SET_H
 
-//#include "code.h"
-//#include "common_ops.h"
-//#include "types.h"
+#include "opcode.hpp"
+#include "registry.hpp"
 
+#include <bitset>
+#include <cstddef>
 #include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace cppush {
 
-class State;
-
+// The opcodes available to a problem, e.g. for PushGP to draw genes from.
+// Names resolve through find_opcode's perfect hash, so loading many programs
+// by name costs one hash per instruction rather than string compares
 class InstructionSet {
 public:
-	std::uint8_t get_opcode(std::string name) {
-		for (std::uint8_t i = 0; i < names.size(); ++i) {
-			if (names[i] == name) {
-				return i;
-			}
+	InstructionSet() = default;
+	InstructionSet(const std::vector<std::string_view>& names) { add(names); }
+
+	// register every name. throws std::invalid_argument without changing the
+	// set if any isn't an opcode
+	void add(const std::vector<std::string_view>& names) {
+		std::vector<Opcode> found;
+		found.reserve(names.size());
+		for (auto name : names) {
+			found.push_back(lookup(name));
+		}
+		for (auto opcode : found) {
+			add(opcode);
+		}
+	}
+
+	void add(Opcode opcode) {
+		if (!contains(opcode)) {
+			enabled.set(static_cast<std::size_t>(opcode));
+			opcodes.push_back(opcode);
 		}
-		// TODO: what do if not found?
-		throw std::invalid_argument("Unrecognized opcode: " + name);
 	}
 
-	auto get_op(std::string name) {
-		return instructions[get_opcode(name)];
+	bool contains(Opcode opcode) const { return enabled.test(static_cast<std::size_t>(opcode)); }
+	// registered opcodes, in the order they were added
+	const std::vector<Opcode>& get_opcodes() const { return opcodes; }
+
+	// the registered opcode called name. throws std::invalid_argument if there
+	// is no such opcode or it isn't registered
+	Opcode get_opcode(std::string_view name) const {
+		Opcode opcode = lookup(name);
+		if (!contains(opcode)) {
+			throw std::invalid_argument("Opcode not in instruction set: " + std::string(name));
+		}
+		return opcode;
 	}
 
 private:
-	std::vector<std::string> names;
-	std::vector<void (*)(State&)> instructions;
+	static Opcode lookup(std::string_view name) {
+		if (auto opcode = find_opcode(name)) {
+			return *opcode;
+		}
+		throw std::invalid_argument("Unrecognized opcode: " + std::string(name));
+	}
+
+	std::bitset<opcode_count> enabled;
+	std::vector<Opcode> opcodes;
 };
 
-//void register_core(std::vector<Instruction>& instruction_set);
-//std::vector<Instruction> register_core();
+// Append the core instructions that only use the given stacks (bits from
+// cppush::stack). a scan of the compile-time registry
+inline void register_core_by_stack(InstructionSet& instruction_set, std::uint8_t stacks) {
+	for (const auto& info : instructions) {
+		if (info.core && (info.stacks & ~stacks) == 0) {
+			instruction_set.add(info.opcode);
+		}
+	}
+}
+
+inline InstructionSet register_core_by_stack(std::uint8_t stacks) {
+	InstructionSet instruction_set;
+	register_core_by_stack(instruction_set, stacks);
+	return instruction_set;
+}
+
+// every instruction that can appear in a genome
+inline InstructionSet register_core() {
+	return register_core_by_stack(stack::exec | stack::number | stack::boolean);
+}
 
 //void register_core_by_name(std::vector<Instruction>& instruction_set, std::vector<std::string> names);
 //std::vector<Instruction> register_core_by_name(std::vector<std::string> names);
 
-// Append instructions for the enabled stacks
-//void register_core_by_stack(std::vector<Instruction>& instruction_set, const Types& types);
-//std::vector<Instruction> register_core_by_stack(const Types& types);
-
 /**
  * Uses recursive templates to generate the functions at compile time.
  * This lets us use a vector of Instructions and avoid polymorphism.
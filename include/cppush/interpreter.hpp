@@ -0,0 +1,270 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "frame_stack.hpp"
+#include "opcode.hpp"
+#include "program.hpp"
+#include "registry.hpp"
+#include "stacks.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace cppush {
+
+// An interpreter specialised for a fixed instruction set, e.g.
+// Interpreter<Opcode::input, Opcode::number_add, Opcode::number_sin>.
+// Dispatch only compares against the listed opcodes and every instruction is
+// inlined into the loop instead of called through State's op table. Stacks no
+// listed instruction uses are left out. block is always supported, and the
+// literal opcodes are whenever there is a number stack, since genome
+// translation emits them
+template <template <typename...> class Storage, Opcode... Ops>
+class BasicInterpreter {
+	static_assert(((Ops > Opcode::block) && ...), "block and literal opcodes are always supported, so aren't listed");
+
+public:
+	static constexpr std::uint8_t used_stacks = (std::uint8_t(0) | ... | instruction_info(Ops).stacks);
+	static constexpr bool has_numbers = (used_stacks & stack::number) != 0;
+	static constexpr bool has_bools = (used_stacks & stack::boolean) != 0;
+
+	BasicInterpreter() = default;
+	// capacity of every stack, for slab storage
+	template <template <typename...> class S = Storage,
+		std::enable_if_t<std::is_same_v<StacksFor<S, used_stacks>, StacksFor<SlabStacks, used_stacks>>, int> = 0>
+	explicit BasicInterpreter(std::size_t capacity) : stacks(capacity) {}
+
+	static constexpr bool supports(Opcode opcode) {
+		switch (opcode) {
+		case Opcode::block:
+			return true;
+		case Opcode::literal:
+		case Opcode::literal_int:
+		case Opcode::literal_constant:
+			return has_numbers;
+		default:
+			return ((opcode == Ops) || ...);
+		}
+	}
+
+	static bool supports(const Program& program) {
+		return std::all_of(program.code.begin(), program.code.end(), [](Bytecode insn) { return supports(insn.opcode); });
+	}
+
+	// the same budget as State::set_effort_limit
+	void set_effort_limit(std::size_t limit) { frames.set_effort_limit(limit); }
+	// instructions charged by the last run, and whether it went over the limit
+	std::size_t get_effort() const { return frames.get_effort(); }
+	bool cut_off() const { return frames.cut_off(); }
+
+	// throws std::invalid_argument on reaching an opcode that isn't supported
+	void run(const Program& program, const std::vector<double>& inputs = {}) {
+		this->inputs = inputs.data();
+		num_inputs = inputs.size();
+
+		frames.start(program);
+		while (!frames.empty()) {
+			Bytecode insn = frames.next();
+			if (insn.opcode == Opcode::block) {
+				frames.push(program, program.blocks[insn.arg]);
+			} else if (!run_literal(insn, program) && !((insn.opcode == Ops && (execute<Ops>(insn, program), true)) || ...)) {
+				throw std::invalid_argument("Opcode not in interpreter: " + std::string(opcode_name(insn.opcode)));
+			}
+		}
+	}
+
+	// only stacks a listed instruction uses exist
+	template <typename T>
+	auto& get_stack() { return stacks.template get<T>(); }
+
+private:
+	auto& number_stack() { return stacks.template get<double>(); }
+	auto& bool_stack() { return stacks.template get<bool>(); }
+
+	bool run_literal(Bytecode insn, const Program& program) {
+		if constexpr (has_numbers) {
+			switch (insn.opcode) {
+			case Opcode::literal:
+				number_stack().push_back(program.number_pool[insn.arg]);
+				return true;
+			case Opcode::literal_int:
+			case Opcode::literal_constant:
+				number_stack().push_back(immediate_value(insn));
+				return true;
+			default:
+				break;
+			}
+		}
+		return false;
+	}
+
+	template <Opcode op>
+	void execute(Bytecode insn, const Program& program) {
+		// checked and unchecked variants are the same, as the helpers check depth
+		if constexpr (op == Opcode::input) {
+			push_input(insn.arg);
+		} else if constexpr (op == Opcode::bool_input) {
+			if (insn.arg < num_inputs) {
+				bool_stack().push_back(inputs[insn.arg] != 0);
+			}
+		} else if constexpr (op == Opcode::exec_dup) {
+			frames.dup_next();
+		} else if constexpr (op == Opcode::exec_if) {
+			auto& bools = bool_stack();
+			if (frames.has_two_items() && !bools.empty()) {
+				bool condition = bools.back();
+				bools.pop_back();
+				if (condition) {
+					frames.skip_second();
+				} else {
+					frames.pop_next();
+				}
+			}
+		} else if constexpr (op == Opcode::exec_pop) {
+			frames.pop_next();
+		} else if constexpr (op == Opcode::number_add || op == Opcode::number_add_unchecked) {
+			binary(std::plus<>());
+		} else if constexpr (op == Opcode::number_sub || op == Opcode::number_sub_unchecked) {
+			binary(std::minus<>());
+		} else if constexpr (op == Opcode::number_mul || op == Opcode::number_mul_unchecked) {
+			binary(std::multiplies<>());
+		} else if constexpr (op == Opcode::number_div || op == Opcode::number_div_unchecked) {
+			binary(std::divides<>());
+		} else if constexpr (op == Opcode::number_mod || op == Opcode::number_mod_unchecked) {
+			binary([](double a, double b) { return std::fmod(a, b); });
+		} else if constexpr (op == Opcode::number_max || op == Opcode::number_max_unchecked) {
+			binary([](double a, double b) { return std::max(a, b); });
+		} else if constexpr (op == Opcode::number_min || op == Opcode::number_min_unchecked) {
+			binary([](double a, double b) { return std::min(a, b); });
+		} else if constexpr (op == Opcode::number_cos || op == Opcode::number_cos_unchecked) {
+			unary([](double a) { return std::cos(a); });
+		} else if constexpr (op == Opcode::number_sin || op == Opcode::number_sin_unchecked) {
+			unary([](double a) { return std::sin(a); });
+		} else if constexpr (op == Opcode::number_tan || op == Opcode::number_tan_unchecked) {
+			unary([](double a) { return std::tan(a); });
+		} else if constexpr (op == Opcode::number_lt) {
+			compare(std::less<>());
+		} else if constexpr (op == Opcode::number_gt) {
+			compare(std::greater<>());
+		} else if constexpr (op == Opcode::bool_and) {
+			logic([](bool a, bool b) { return a && b; });
+		} else if constexpr (op == Opcode::bool_or) {
+			logic([](bool a, bool b) { return a || b; });
+		} else if constexpr (op == Opcode::bool_not) {
+			auto& bools = bool_stack();
+			if (!bools.empty()) {
+				bools.back() = !bools.back();
+			}
+		} else if constexpr (op == Opcode::bool_nand) {
+			logic([](bool a, bool b) { return !(a && b); });
+		} else if constexpr (op == Opcode::bool_nor) {
+			logic([](bool a, bool b) { return !(a || b); });
+		} else if constexpr (op == Opcode::bool_xor) {
+			logic([](bool a, bool b) { return a != b; });
+		} else if constexpr (op == Opcode::bool_invert_first_then_and) {
+			logic([](bool a, bool b) { return a && !b; });
+		} else if constexpr (op == Opcode::bool_invert_second_then_and) {
+			logic([](bool a, bool b) { return !a && b; });
+		} else if constexpr (op >= Opcode::literal_add && op <= Opcode::literal_mul_add) {
+			number_stack().push_back(program.number_pool[insn.arg]);
+			fused_tail<op, Opcode::literal_add>();
+		} else if constexpr (op >= Opcode::input_add && op <= Opcode::input_mul_add) {
+			push_input(insn.arg);
+			fused_tail<op, Opcode::input_add>();
+		} else {
+			static_assert(op != op, "Interpreter can't run this opcode");
+		}
+	}
+
+	// the instructions a superinstruction runs after pushing its operand.
+	// each family is ordered add, sub, mul, div, mul_add
+	template <Opcode op, Opcode first>
+	void fused_tail() {
+		constexpr auto offset = static_cast<int>(op) - static_cast<int>(first);
+		if constexpr (offset == 0) {
+			binary(std::plus<>());
+		} else if constexpr (offset == 1) {
+			binary(std::minus<>());
+		} else if constexpr (offset == 2) {
+			binary(std::multiplies<>());
+		} else if constexpr (offset == 3) {
+			binary(std::divides<>());
+		} else {
+			binary(std::multiplies<>());
+			binary(std::plus<>());
+		}
+	}
+
+	void push_input(std::size_t n) {
+		if (n < num_inputs) {
+			number_stack().push_back(inputs[n]);
+		}
+	}
+
+	// replace the top two numbers a, b with f(a, b). noop if there are fewer than two
+	template <typename F>
+	void binary(F f) {
+		auto& stack = number_stack();
+		if (stack.size() >= 2) {
+			double b = stack.back();
+			stack.pop_back();
+			stack.back() = f(stack.back(), b);
+		}
+	}
+
+	template <typename F>
+	void unary(F f) {
+		auto& stack = number_stack();
+		if (!stack.empty()) {
+			stack.back() = f(stack.back());
+		}
+	}
+
+	// pop two numbers a, b and push f(a, b) to the bool stack
+	template <typename F>
+	void compare(F f) {
+		auto& stack = number_stack();
+		if (stack.size() >= 2) {
+			double b = stack.back();
+			stack.pop_back();
+			double a = stack.back();
+			stack.pop_back();
+			bool_stack().push_back(f(a, b));
+		}
+	}
+
+	template <typename F>
+	void logic(F f) {
+		auto& stack = bool_stack();
+		if (stack.size() >= 2) {
+			bool b = stack.back();
+			stack.pop_back();
+			stack.back() = f(stack.back(), b);
+		}
+	}
+
+	FrameStack frames;
+	StacksFor<Storage, used_stacks> stacks;
+
+	// inputs of the Program being run
+	const double* inputs = nullptr;
+	std::size_t num_inputs = 0;
+};
+
+template <Opcode... Ops>
+using Interpreter = BasicInterpreter<Stacks, Ops...>;
+
+// keeps its stacks in one allocation. see SlabStacks
+template <Opcode... Ops>
+using SlabInterpreter = BasicInterpreter<SlabStacks, Ops...>;
+
+} // namespace cppush
+
+#endif // INTERPRETER_H
@@ -0,0 +1,45 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "program.hpp"
+
+#include <cstddef>
+
+namespace cppush {
+
+// A Program compiled to x86-64 machine code. Only straight-line number
+// programs compile: literals, inputs, blocks, number ops and their
+// superinstructions and unchecked variants. With no exec instructions the
+// stack depth before every instruction is known, so underflowing ops are
+// dropped at compile time and stack items live at fixed slots in the native
+// frame with the top cached in a register.
+class NativeProgram {
+public:
+	using Function = double (*)(const double* inputs);
+
+	// whether program can be compiled on this platform
+	static bool supports(const Program& program);
+
+	// compile program for exactly `inputs` inputs. throws
+	// std::invalid_argument if it isn't supported
+	NativeProgram(const Program& program, std::size_t inputs);
+	~NativeProgram();
+	NativeProgram(NativeProgram&& other) noexcept;
+	NativeProgram& operator=(NativeProgram&& other) noexcept;
+	NativeProgram(const NativeProgram&) = delete;
+	NativeProgram& operator=(const NativeProgram&) = delete;
+
+	// top of the number stack (NaN if empty) after running on inputs
+	double operator()(const double* inputs) const { return entry(inputs); }
+	// the compiled code. only valid while this NativeProgram is alive
+	Function function() const { return entry; }
+
+private:
+	void* memory = nullptr;
+	std::size_t size = 0;
+	Function entry = nullptr;
+};
+
+} // namespace cppush
+
+#endif // JIT_H
@@ -1,21 +1,188 @@
 #ifndef NUMBER_OPS_HPP
 #define NUMBER_OPS_HPP
 
+#include <algorithm>
+#include <cmath>
+
 namespace cppush {
 
-class State;
+// Number instructions, for any state type with get_stack, push and pop.
+// variants without the stack size check are for instructions that analysis
+// proves always have enough operands. see analysis.hpp
+
+template <typename State>
+unsigned number_add_unchecked(State& state) {
+	double top = state.template pop<double>();
+	state.template get_stack<double>().back() += top;
+	return 1;
+}
+
+template <typename State>
+unsigned number_add(State& state) {
+	if (state.template get_stack<double>().size() >= 2) {
+		number_add_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_sub_unchecked(State& state) {
+	double top = state.template pop<double>();
+	state.template get_stack<double>().back() -= top;
+	return 1;
+}
+
+template <typename State>
+unsigned number_sub(State& state) {
+	if (state.template get_stack<double>().size() >= 2) {
+		number_sub_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_mul_unchecked(State& state) {
+	double top = state.template pop<double>();
+	state.template get_stack<double>().back() *= top;
+	return 1;
+}
+
+template <typename State>
+unsigned number_mul(State& state) {
+	if (state.template get_stack<double>().size() >= 2) {
+		number_mul_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_div_unchecked(State& state) {
+	double top = state.template pop<double>();
+	state.template get_stack<double>().back() /= top;
+	return 1;
+}
+
+template <typename State>
+unsigned number_div(State& state) {
+	if (state.template get_stack<double>().size() >= 2) {
+		number_div_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_mod_unchecked(State& state) {
+	double b = state.template pop<double>();
+	double a = state.template pop<double>();
+	state.template push<double>(std::fmod(a, b));
+	return 1;
+}
+
+template <typename State>
+unsigned number_mod(State& state) {
+	if (state.template get_stack<double>().size() >= 2) {
+		number_mod_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_max_unchecked(State& state) {
+	double b = state.template pop<double>();
+	double a = state.template pop<double>();
+	state.template push<double>(std::max(a, b));
+	return 1;
+}
+
+template <typename State>
+unsigned number_max(State& state) {
+	if (state.template get_stack<double>().size() >= 2) {
+		number_max_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_min_unchecked(State& state) {
+	double b = state.template pop<double>();
+	double a = state.template pop<double>();
+	state.template push<double>(std::min(a, b));
+	return 1;
+}
+
+template <typename State>
+unsigned number_min(State& state) {
+	if (state.template get_stack<double>().size() >= 2) {
+		number_min_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_cos_unchecked(State& state) {
+	double top = state.template pop<double>();
+	state.template push<double>(std::cos(top));
+	return 1;
+}
+
+template <typename State>
+unsigned number_cos(State& state) {
+	if (state.template get_stack<double>().size() >= 1) {
+		number_cos_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_sin_unchecked(State& state) {
+	double top = state.template pop<double>();
+	state.template push<double>(std::sin(top));
+	return 1;
+}
+
+template <typename State>
+unsigned number_sin(State& state) {
+	if (state.template get_stack<double>().size() >= 1) {
+		number_sin_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_tan_unchecked(State& state) {
+	double top = state.template pop<double>();
+	state.template push<double>(std::tan(top));
+	return 1;
+}
+
+template <typename State>
+unsigned number_tan(State& state) {
+	if (state.template get_stack<double>().size() >= 1) {
+		number_tan_unchecked(state);
+	}
+	return 1;
+}
+
+template <typename State>
+unsigned number_lt(State& state) {
+	if (state.template get_stack<double>().size() >= 2) {
+		double b = state.template pop<double>();
+		double a = state.template pop<double>();
+		state.template push<bool>(a < b);
+	}
+	return 1;
+}
 
-unsigned number_add(State&);
-unsigned number_sub(State&);
-unsigned number_mul(State&);
-unsigned number_div(State&);
-unsigned number_mod(State&);
-unsigned number_max(State&);
-unsigned number_min(State&);
-unsigned number_cos(State&);
-unsigned number_sin(State&);
-unsigned number_tan(State&);
+template <typename State>
+unsigned number_gt(State& state) {
+	if (state.template get_stack<double>().size() >= 2) {
+		double b = state.template pop<double>();
+		double a = state.template pop<double>();
+		state.template push<bool>(a > b);
+	}
+	return 1;
+}
 
 } // namespace cppush
 
-#endif // NUMBER_OPS_HPP
\ No newline at end of file
+#endif // NUMBER_OPS_HPP
@@ -0,0 +1,88 @@
+#ifndef OPCODE_H
+#define OPCODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace cppush {
+
+// Instructions understood by State::run(const Program&).
+// Values are dense so an opcode can index a dispatch table directly
+enum class Opcode : std::uint8_t {
+	// interpreter built-ins
+	literal, // push Program::number_pool[arg]
+	literal_int, // push arg as a signed byte
+	literal_constant, // push common_constants[arg]
+	block, // push Program::blocks[arg] onto the exec stack
+	input, // push the arg-th input, if there is one
+	bool_input, // push whether the arg-th input is nonzero, if there is one
+
+	// exec. these manipulate interpreter frames so are also built-ins
+	exec_dup,
+	exec_if, // run one of the next two items depending on the top bool
+	exec_pop,
+
+	// number
+	number_add,
+	number_sub,
+	number_mul,
+	number_div,
+	number_mod,
+	number_max,
+	number_min,
+	number_cos,
+	number_sin,
+	number_tan,
+	number_lt,
+	number_gt,
+
+	// bool
+	bool_and,
+	bool_or,
+	bool_not,
+	bool_nand,
+	bool_nor,
+	bool_xor,
+	bool_invert_first_then_and,
+	bool_invert_second_then_and,
+
+	// superinstructions. each behaves like the sequence in its name, with the
+	// arg of the leading literal/input. see fusion.hpp
+	literal_add,
+	literal_sub,
+	literal_mul,
+	literal_div,
+	literal_mul_add,
+	input_add,
+	input_sub,
+	input_mul,
+	input_div,
+	input_mul_add,
+
+	// number instructions without the stack size check. see analysis.hpp
+	number_add_unchecked,
+	number_sub_unchecked,
+	number_mul_unchecked,
+	number_div_unchecked,
+	number_mod_unchecked,
+	number_max_unchecked,
+	number_min_unchecked,
+	number_cos_unchecked,
+	number_sin_unchecked,
+	number_tan_unchecked,
+
+	count // number of opcodes, not an instruction
+};
+
+constexpr std::size_t opcode_count = static_cast<std::size_t>(Opcode::count);
+
+// the opcode's enumerator as a string
+std::string_view opcode_name(Opcode opcode);
+// the opcode with that name, if there is one. a perfect hash lookup
+std::optional<Opcode> find_opcode(std::string_view name);
+
+} // namespace cppush
+
+#endif // OPCODE_H
@@ -1,24 +1,50 @@
 #ifndef PROGRAM_H
 #define PROGRAM_H
 
-#include "literal_base.hpp"
+#include "opcode.hpp"
 
 #include <cstdint>
-#include <memory>
 #include <vector>
 
 namespace cppush {
 
 struct Bytecode {
-	std::uint8_t opcode;
-	std::uint8_t arg;
+	Opcode opcode;
+	std::uint8_t arg = 0;
+};
+
+// values Opcode::literal_constant pushes without needing a pool entry.
+// integers in [-128, 127] have Opcode::literal_int instead
+constexpr double common_constants[] = {
+	-0.0,
+	0.5,
+	-0.5,
+	0.25,
+	0.1,
+	3.141592653589793, // pi
+	1.5707963267948966, // pi / 2
+	6.283185307179586, // 2 pi
+	2.718281828459045, // e
+	1.4142135623730951, // sqrt(2)
+	0.6931471805599453, // ln(2)
+};
+
+// value pushed by a literal_int or literal_constant instruction
+constexpr double immediate_value(Bytecode insn) {
+	return insn.opcode == Opcode::literal_int ? std::int8_t(insn.arg) : common_constants[insn.arg];
+}
+
+// a code list, stored as the range [begin, end) of Program::code
+struct Block {
+	std::uint32_t begin;
+	std::uint32_t end;
 };
 
 // TODO: include interpreter settings
 struct Program {
-	std::vector<Bytecode> code; // main program
-	std::vector<std::vector<Bytecode>> blocks; // nested code lists
-	std::vector<std::shared_ptr<LiteralBase>> constant_pool;
+	std::vector<Bytecode> code; // every block, stored contiguously
+	std::vector<Block> blocks; // blocks[0] is the main program
+	std::vector<double> number_pool; // constants, indexed by the arg of literal opcodes
 };
 
 } // namespace cppush
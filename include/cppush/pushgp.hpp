@@ -0,0 +1,123 @@
+#ifndef PUSHGP_H
+#define PUSHGP_H
+
+#include "genome.hpp"
+#include "program.hpp"
+#include "state.hpp"
+#include "thread_pool.hpp"
+#include "tiering.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace cppush {
+
+using ErcGenerator = std::function<double (std::mt19937&)>;
+
+// when individuals move off the interpreter. see TieredProgram
+struct TieringConfig {
+	bool enabled = true;
+	int promote_after_generations = 2; // generations survived as an elite
+	std::size_t promote_after_runs = 100'000; // executions, counting every fitness case
+};
+
+struct PushGPConfig {
+	std::vector<Bytecode> instruction_set; // with args, e.g. one input per index
+	std::vector<double> literal_set;
+	std::vector<ErcGenerator> erc_generators;
+	TieringConfig tiering;
+	std::size_t effort_limit = 10'000; // instructions a run may charge before it's cut off
+	// wall clock time a run may take (0 for no limit). an individual with a run
+	// that times out gets timeout_penalty as its error, and its other cases are skipped
+	std::chrono::nanoseconds time_limit{0};
+	double timeout_penalty = 1e12;
+	// evaluate individuals on this many threads (0 for one per hardware
+	// thread). results don't depend on it
+	unsigned threads = 0;
+	// fitness cases are evaluated in tiles sized to fit this much cache, with
+	// every program in a group running on a tile before moving to the next
+	std::size_t cache_bytes = 512 * 1024;
+	int population_size = 500;
+	int max_generations = 100;
+	int initial_genome_size = 50;
+	int elite_count = 5; // best individuals copied unchanged into the next generation
+	int tournament_size = 7;
+	double umad_rate = 0.1; // uniform mutation by addition and deletion
+};
+
+// time spent running individuals on each tier, and on compiling them
+struct TierStats {
+	std::array<std::size_t, tier_count> runs{};
+	std::array<std::chrono::nanoseconds, tier_count> time{};
+	std::size_t promotions = 0;
+	std::chrono::nanoseconds compile_time{};
+};
+
+class PushGP {
+public:
+	PushGP(PushGPConfig config);
+	PushGP(PushGPConfig config, unsigned seed);
+	virtual ~PushGP() = default;
+
+	const Program& get_best() const;
+	double get_best_score() const { return best_score; }
+	const TierStats& get_tier_stats() const { return tier_stats; }
+
+protected:
+	struct Individual {
+		Genome genome;
+		std::shared_ptr<TieredProgram> program; // shared by elite copies, so compiled code survives
+		int age = 0; // generations survived as an elite
+		double error = 0;
+		// instructions charged over every case when last evaluated. 0 until then
+		std::size_t effort = 0;
+	};
+
+	virtual std::size_t num_fitness_cases() const = 0;
+	virtual std::size_t num_inputs() const = 0;
+	// error of program on a fitness case. lower is better. state is scratch
+	// space for running the program, reused across cases and individuals
+	virtual double evaluate(TieredProgram& program, State& state, std::size_t fitness_case_index) const = 0;
+	// memory one fitness case's data takes, for sizing tiles of cases
+	virtual std::size_t case_bytes() const { return (num_inputs() + 1) * sizeof(double); }
+
+	void train(int gens); // throws if no fitness cases loaded
+	void evaluate_population();
+	void next_generation();
+	// boundaries of the groups of individuals evaluate_population hands out
+	std::vector<std::size_t> group_programs() const;
+
+	PushGPConfig config;
+	std::mt19937 rng;
+	int generation = 0;
+	std::vector<Individual> population;
+	double best_score;
+	std::shared_ptr<TieredProgram> best_individual;
+	TierStats tier_stats;
+	std::unique_ptr<ThreadPool> pool;
+	// one per pool worker, reused for every run so stacks keep their capacity.
+	// states[0] belongs to the calling thread
+	std::vector<State> states;
+	// error of every individual summed over each tile of cases, row major.
+	// added up in tile order once every tile is done, so totals don't depend
+	// on the schedule
+	std::vector<double> tile_errors;
+
+private:
+	void init();
+	void promote(TieredProgram& program);
+	Individual make_individual(Genome genome) const;
+	const Individual& tournament();
+	Genome mutate(const Genome& genome);
+	Genome random_genome(int size);
+	Gene random_gene();
+};
+
+} // namespace cppush
+
+#endif // PUSHGP_H
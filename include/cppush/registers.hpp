@@ -0,0 +1,54 @@
+#ifndef REGISTERS_H
+#define REGISTERS_H
+
+#include "program.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cppush {
+
+// A straight-line number Program (see is_straight_line) translated from stack
+// code to SSA register code. Every value is computed once into its own
+// register, so stack traffic disappears: values computed twice from the same
+// operands share a register and values that never reach the final stack
+// aren't computed at all. Only the number stack is modelled
+class RegisterProgram {
+public:
+	enum class Op : std::uint8_t {
+		constant, // value
+		input, // inputs[a]
+		add, sub, mul, div, mod, max, min, // registers a, b
+		cos, sin, tan, // register a
+	};
+	struct Insn {
+		Op op;
+		std::uint32_t a = 0;
+		std::uint32_t b = 0;
+		double value = 0;
+	};
+
+	// translate program for exactly `inputs` inputs. throws
+	// std::invalid_argument if program isn't straight-line
+	RegisterProgram(const Program& program, std::size_t inputs);
+
+	// instruction i writes register i
+	const std::vector<Insn>& get_code() const { return code; }
+	// registers holding the final number stack, bottom first
+	const std::vector<std::uint32_t>& get_stack() const { return stack; }
+
+	// compute every register. registers is resized to fit, so reusing it
+	// between runs avoids allocating
+	void run(const double* inputs, std::vector<double>& registers) const;
+	// top of the final number stack (NaN if empty)
+	double run(const double* inputs) const;
+
+private:
+	std::vector<Insn> code;
+	std::vector<std::uint32_t> stack;
+};
+
+} // namespace cppush
+
+#endif // REGISTERS_H
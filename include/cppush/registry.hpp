@@ -0,0 +1,141 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "boolean_ops.hpp"
+#include "number_ops.hpp"
+#include "opcode.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace cppush {
+
+// bits of InstructionInfo::stacks
+namespace stack {
+constexpr std::uint8_t exec = 1 << 0;
+constexpr std::uint8_t number = 1 << 1;
+constexpr std::uint8_t boolean = 1 << 2;
+} // namespace stack
+
+struct InstructionInfo {
+	Opcode opcode;
+	std::string_view name;
+	std::uint8_t stacks; // stacks the instruction uses
+	unsigned parens; // blocks opened after the instruction in a genome
+	bool core; // can appear in a genome, rather than only being made by translation or program passes
+};
+
+// Every opcode, in opcode order. Built at compile time so nothing runs at
+// startup and lookups are plain array indexing. The function running each is
+// op_for<State>(opcode), as ops are instantiated per state type
+inline constexpr InstructionInfo instructions[] = {
+	{Opcode::literal, "literal", stack::number, 0, false},
+	{Opcode::literal_int, "literal_int", stack::number, 0, false},
+	{Opcode::literal_constant, "literal_constant", stack::number, 0, false},
+	{Opcode::block, "block", stack::exec, 0, false},
+	{Opcode::input, "input", stack::number, 0, true},
+	{Opcode::bool_input, "bool_input", stack::boolean, 0, true},
+	{Opcode::exec_dup, "exec_dup", stack::exec, 1, true},
+	{Opcode::exec_if, "exec_if", stack::exec | stack::boolean, 2, true},
+	{Opcode::exec_pop, "exec_pop", stack::exec, 1, true},
+	{Opcode::number_add, "number_add", stack::number, 0, true},
+	{Opcode::number_sub, "number_sub", stack::number, 0, true},
+	{Opcode::number_mul, "number_mul", stack::number, 0, true},
+	{Opcode::number_div, "number_div", stack::number, 0, true},
+	{Opcode::number_mod, "number_mod", stack::number, 0, true},
+	{Opcode::number_max, "number_max", stack::number, 0, true},
+	{Opcode::number_min, "number_min", stack::number, 0, true},
+	{Opcode::number_cos, "number_cos", stack::number, 0, true},
+	{Opcode::number_sin, "number_sin", stack::number, 0, true},
+	{Opcode::number_tan, "number_tan", stack::number, 0, true},
+	{Opcode::number_lt, "number_lt", stack::number | stack::boolean, 0, true},
+	{Opcode::number_gt, "number_gt", stack::number | stack::boolean, 0, true},
+	{Opcode::bool_and, "bool_and", stack::boolean, 0, true},
+	{Opcode::bool_or, "bool_or", stack::boolean, 0, true},
+	{Opcode::bool_not, "bool_not", stack::boolean, 0, true},
+	{Opcode::bool_nand, "bool_nand", stack::boolean, 0, true},
+	{Opcode::bool_nor, "bool_nor", stack::boolean, 0, true},
+	{Opcode::bool_xor, "bool_xor", stack::boolean, 0, true},
+	{Opcode::bool_invert_first_then_and, "bool_invert_first_then_and", stack::boolean, 0, true},
+	{Opcode::bool_invert_second_then_and, "bool_invert_second_then_and", stack::boolean, 0, true},
+	{Opcode::literal_add, "literal_add", stack::number, 0, false},
+	{Opcode::literal_sub, "literal_sub", stack::number, 0, false},
+	{Opcode::literal_mul, "literal_mul", stack::number, 0, false},
+	{Opcode::literal_div, "literal_div", stack::number, 0, false},
+	{Opcode::literal_mul_add, "literal_mul_add", stack::number, 0, false},
+	{Opcode::input_add, "input_add", stack::number, 0, false},
+	{Opcode::input_sub, "input_sub", stack::number, 0, false},
+	{Opcode::input_mul, "input_mul", stack::number, 0, false},
+	{Opcode::input_div, "input_div", stack::number, 0, false},
+	{Opcode::input_mul_add, "input_mul_add", stack::number, 0, false},
+	{Opcode::number_add_unchecked, "number_add_unchecked", stack::number, 0, false},
+	{Opcode::number_sub_unchecked, "number_sub_unchecked", stack::number, 0, false},
+	{Opcode::number_mul_unchecked, "number_mul_unchecked", stack::number, 0, false},
+	{Opcode::number_div_unchecked, "number_div_unchecked", stack::number, 0, false},
+	{Opcode::number_mod_unchecked, "number_mod_unchecked", stack::number, 0, false},
+	{Opcode::number_max_unchecked, "number_max_unchecked", stack::number, 0, false},
+	{Opcode::number_min_unchecked, "number_min_unchecked", stack::number, 0, false},
+	{Opcode::number_cos_unchecked, "number_cos_unchecked", stack::number, 0, false},
+	{Opcode::number_sin_unchecked, "number_sin_unchecked", stack::number, 0, false},
+	{Opcode::number_tan_unchecked, "number_tan_unchecked", stack::number, 0, false},
+};
+
+constexpr bool in_opcode_order() {
+	for (std::size_t i = 0; i < std::size(instructions); ++i) {
+		if (static_cast<std::size_t>(instructions[i].opcode) != i) {
+			return false;
+		}
+	}
+	return std::size(instructions) == opcode_count;
+}
+static_assert(in_opcode_order(), "instructions must have one entry per opcode, in order");
+
+constexpr const InstructionInfo& instruction_info(Opcode opcode) {
+	return instructions[static_cast<std::size_t>(opcode)];
+}
+
+// the function running opcode on a State (or any BasicState), e.g.
+// number_add<State>. nullptr for instructions the interpreter loops run
+// themselves
+template <typename State>
+constexpr auto op_for(Opcode opcode) -> unsigned (*)(State&) {
+	switch (opcode) {
+	case Opcode::number_add: return number_add<State>;
+	case Opcode::number_sub: return number_sub<State>;
+	case Opcode::number_mul: return number_mul<State>;
+	case Opcode::number_div: return number_div<State>;
+	case Opcode::number_mod: return number_mod<State>;
+	case Opcode::number_max: return number_max<State>;
+	case Opcode::number_min: return number_min<State>;
+	case Opcode::number_cos: return number_cos<State>;
+	case Opcode::number_sin: return number_sin<State>;
+	case Opcode::number_tan: return number_tan<State>;
+	case Opcode::number_lt: return number_lt<State>;
+	case Opcode::number_gt: return number_gt<State>;
+	case Opcode::bool_and: return bool_and<State>;
+	case Opcode::bool_or: return bool_or<State>;
+	case Opcode::bool_not: return bool_not<State>;
+	case Opcode::bool_nand: return bool_nand<State>;
+	case Opcode::bool_nor: return bool_nor<State>;
+	case Opcode::bool_xor: return bool_xor<State>;
+	case Opcode::bool_invert_first_then_and: return bool_invert_first_then_and<State>;
+	case Opcode::bool_invert_second_then_and: return bool_invert_second_then_and<State>;
+	case Opcode::number_add_unchecked: return number_add_unchecked<State>;
+	case Opcode::number_sub_unchecked: return number_sub_unchecked<State>;
+	case Opcode::number_mul_unchecked: return number_mul_unchecked<State>;
+	case Opcode::number_div_unchecked: return number_div_unchecked<State>;
+	case Opcode::number_mod_unchecked: return number_mod_unchecked<State>;
+	case Opcode::number_max_unchecked: return number_max_unchecked<State>;
+	case Opcode::number_min_unchecked: return number_min_unchecked<State>;
+	case Opcode::number_cos_unchecked: return number_cos_unchecked<State>;
+	case Opcode::number_sin_unchecked: return number_sin_unchecked<State>;
+	case Opcode::number_tan_unchecked: return number_tan_unchecked<State>;
+	default: return nullptr;
+	}
+}
+
+} // namespace cppush
+
+#endif // REGISTRY_H
@@ -0,0 +1,34 @@
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include "pushgp.hpp"
+#include "state.hpp"
+#include "tiering.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace cppush {
+
+// evolves a program computing outputs from one number input
+class FloatRegression : public PushGP {
+public:
+	using PushGP::PushGP;
+
+	void fit(std::vector<double> inputs, std::vector<double> outputs, int gens);
+	// output of the best program, 0 if it leaves the number stack empty
+	double predict(double input);
+
+protected:
+	std::size_t num_fitness_cases() const override;
+	std::size_t num_inputs() const override { return 1; }
+	double evaluate(TieredProgram& program, State& state, std::size_t fitness_case_index) const override;
+
+private:
+	std::vector<std::vector<double>> inputs; // one input vector per case
+	std::vector<double> outputs;
+};
+
+} // namespace cppush
+
+#endif // REGRESSION_H
@@ -0,0 +1,211 @@
+#ifndef STACKS_H
+#define STACKS_H
+
+#include "registry.hpp"
+#include "state_fwd.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cppush {
+
+class Code;
+
+// what a stack of T holds
+template <typename T> struct stack_item { using type = T; };
+template <> struct stack_item<Exec> { using type = std::shared_ptr<Code>; };
+
+// One stack per type in the list and nothing for any other type. get<T> is
+// resolved at compile time, and asking for a stack that isn't in the list
+// doesn't compile
+template <typename... Types>
+class Stacks {
+public:
+	static constexpr bool drops_pushes = false;
+
+	template <typename T>
+	static constexpr bool contains = (std::is_same_v<T, Types> || ...);
+
+	template <typename T>
+	auto& get() {
+		static_assert(contains<T>, "no stack of this type");
+		return std::get<std::vector<typename stack_item<T>::type>>(stacks);
+	}
+
+	void clear() {
+		std::apply([](auto&... stack) { (stack.clear(), ...); }, stacks);
+	}
+
+private:
+	std::tuple<std::vector<typename stack_item<Types>::type>...> stacks;
+};
+
+// A stack in a slab of memory owned by SlabStacks, with a fixed capacity.
+// Pushes onto a full stack are dropped, like Push's max stack depth
+template <typename T>
+class SlabStack {
+	static_assert(std::is_trivially_copyable_v<T>, "slab stacks hold plain values");
+
+public:
+	using value_type = T;
+
+	SlabStack(T* items, std::size_t capacity) : items(items), capacity_(capacity) {}
+
+	void push_back(T item) {
+		if (count < capacity_) {
+			new (items + count) T(item);
+			++count;
+		}
+	}
+	void pop_back() { --count; }
+	T& back() { return items[count - 1]; }
+	const T& back() const { return items[count - 1]; }
+	T& operator[](std::size_t i) { return items[i]; }
+	const T& operator[](std::size_t i) const { return items[i]; }
+
+	std::size_t size() const { return count; }
+	std::size_t capacity() const { return capacity_; }
+	bool empty() const { return count == 0; }
+	void clear() { count = 0; }
+
+	T* begin() { return items; }
+	T* end() { return items + count; }
+	const T* begin() const { return items; }
+	const T* end() const { return items + count; }
+
+	// compares items with any container, e.g. a std::vector of the same values
+	template <typename Range>
+	bool operator==(const Range& other) const {
+		return std::equal(begin(), end(), std::begin(other), std::end(other));
+	}
+	template <typename Range>
+	bool operator!=(const Range& other) const { return !(*this == other); }
+
+private:
+	T* items;
+	std::size_t count = 0;
+	std::size_t capacity_;
+};
+
+// The same interface as Stacks, but every stack is carved out of one
+// allocation made up front, so creating, clearing and running touch one
+// compact region. capacity is per stack, e.g. a problem's max points
+template <typename... Types>
+class SlabStacks {
+public:
+	static constexpr std::size_t default_capacity = 1024;
+	// pushes onto a full stack are dropped, so a push may not land
+	static constexpr bool drops_pushes = true;
+
+	template <typename T>
+	static constexpr bool contains = (std::is_same_v<T, Types> || ...);
+
+	explicit SlabStacks(std::size_t capacity = default_capacity)
+		: capacity(capacity),
+		  slab(new unsigned char[(0 + ... + region_size<Types>(capacity))]),
+		  stacks(make_stacks(capacity, std::index_sequence_for<Types...>())) {}
+	// a copy gets its own slab, with the same capacity and items
+	SlabStacks(const SlabStacks& other) : SlabStacks(other.capacity) {
+		(copy_items(std::get<SlabStack<Types>>(other.stacks), std::get<SlabStack<Types>>(stacks)), ...);
+	}
+	SlabStacks& operator=(const SlabStacks& other) {
+		if (this != &other) {
+			SlabStacks copy(other);
+			std::swap(capacity, copy.capacity);
+			std::swap(slab, copy.slab);
+			std::swap(stacks, copy.stacks);
+		}
+		return *this;
+	}
+
+	template <typename T>
+	auto& get() {
+		static_assert(contains<T>, "no stack of this type");
+		return std::get<SlabStack<T>>(stacks);
+	}
+
+	void clear() {
+		std::apply([](auto&... stack) { (stack.clear(), ...); }, stacks);
+	}
+
+private:
+	// bytes for one stack, rounded so the next stack stays aligned
+	template <typename T>
+	static constexpr std::size_t region_size(std::size_t capacity) {
+		constexpr std::size_t align = alignof(std::max_align_t);
+		return (capacity * sizeof(T) + align - 1) / align * align;
+	}
+
+	template <typename T>
+	static void copy_items(const SlabStack<T>& from, SlabStack<T>& to) {
+		for (const T& item : from) {
+			to.push_back(item);
+		}
+	}
+
+	template <std::size_t... I>
+	std::tuple<SlabStack<Types>...> make_stacks(std::size_t capacity, std::index_sequence<I...>) {
+		std::size_t offsets[] = {0, region_size<Types>(capacity)...};
+		for (std::size_t i = 1; i < std::size(offsets); ++i) {
+			offsets[i] += offsets[i - 1];
+		}
+		return {SlabStack<Types>(reinterpret_cast<Types*>(slab.get() + offsets[I]), capacity)...};
+	}
+
+	std::size_t capacity;
+	std::unique_ptr<unsigned char[]> slab;
+	std::tuple<SlabStack<Types>...> stacks;
+};
+
+// Stands in for a stack that a state doesn't have. It's always empty and
+// pushes are dropped, so instructions on it are noops
+template <typename T>
+class NullStack {
+public:
+	using value_type = T;
+
+	void push_back(const T&) {}
+	void pop_back() {}
+	// only reached by unchecked ops, whose analysis assumed pushes land
+	T& back() {
+		static thread_local T item{};
+		return item;
+	}
+
+	std::size_t size() const { return 0; }
+	bool empty() const { return true; }
+	void clear() {}
+};
+
+template <typename T>
+inline NullStack<typename stack_item<T>::type> null_stack;
+
+namespace detail {
+
+template <typename S, typename T, bool add>
+struct append_stack { using type = S; };
+
+template <template <typename...> class Storage, typename... Types, typename T>
+struct append_stack<Storage<Types...>, T, true> { using type = Storage<Types..., T>; };
+
+} // namespace detail
+
+// the value stacks for instructions using the given stacks (bits from
+// cppush::stack), stored in Storage (Stacks or SlabStacks). the exec stack
+// isn't included, as Programs run on a FrameStack
+template <template <typename...> class Storage, std::uint8_t stacks>
+using StacksFor = typename detail::append_stack<
+	typename detail::append_stack<Storage<>, double, (stacks & stack::number) != 0>::type,
+	bool, (stacks & stack::boolean) != 0>::type;
+
+} // namespace cppush
+
+#endif // STACKS_H
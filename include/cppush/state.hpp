@@ -1,44 +1,558 @@
 #ifndef STATE_H
 #define STATE_H
 
+#include "closures.hpp"
 #include "code.hpp"
+#include "deadline.hpp"
+#include "frame_stack.hpp"
+#include "opcode.hpp"
+#include "program.hpp"
+#include "registry.hpp"
+#include "stacks.hpp"
+#include "state_fwd.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace cppush {
 
-class State {
+namespace detail {
+
+// dispatch table for instruction opcodes, from the registry. built-ins are
+// handled by BasicState::run
+template <typename State>
+constexpr std::array<unsigned (*)(State&), opcode_count> make_op_table() {
+	constexpr auto offset = static_cast<int>(Opcode::number_add_unchecked) - static_cast<int>(Opcode::number_add);
+	std::array<unsigned (*)(State&), opcode_count> table{};
+	for (std::size_t i = 0; i < opcode_count; ++i) {
+		auto opcode = static_cast<Opcode>(i);
+		// unchecked ops rely on every push landing, which stacks that drop
+		// pushes can't promise, so those run the checked op instead
+		if (State::drops_pushes && opcode >= Opcode::number_add_unchecked && opcode <= Opcode::number_tan_unchecked) {
+			opcode = static_cast<Opcode>(static_cast<int>(opcode) - offset);
+		}
+		table[i] = op_for<State>(opcode);
+	}
+	return table;
+}
+
+template <typename State>
+inline constexpr auto op_table = make_op_table<State>();
+
+// Holds up to two items from the top of a number stack in locals, so that
+// consecutive number instructions don't go through memory. r0 is the top item
+template <typename Stack>
+class TopCache {
+public:
+	TopCache(Stack& stack) : stack(stack) {}
+
+	void push(double value) {
+		if (cached == 2) {
+			stack.push_back(r1);
+		} else {
+			++cached;
+		}
+		r1 = r0;
+		r0 = value;
+	}
+
+	// replace the top two items a, b with f(a, b). noop if there are fewer than two
+	template <typename F>
+	void binary(F f) {
+		switch (cached) {
+		case 2:
+			r0 = f(r1, r0);
+			break;
+		case 1:
+			if (stack.empty()) {
+				return;
+			}
+			r0 = f(stack.back(), r0);
+			stack.pop_back();
+			break;
+		default: {
+			if (stack.size() < 2) {
+				return;
+			}
+			double b = stack.back();
+			stack.pop_back();
+			r0 = f(stack.back(), b);
+			stack.pop_back();
+		}
+		}
+		cached = 1;
+	}
+
+	// replace the top item a with f(a). noop if the stack is empty
+	template <typename F>
+	void unary(F f) {
+		if (cached == 0) {
+			if (stack.empty()) {
+				return;
+			}
+			r0 = stack.back();
+			stack.pop_back();
+			cached = 1;
+		}
+		r0 = f(r0);
+	}
+
+	// write cached items back to the stack
+	void spill() {
+		if (cached == 2) {
+			stack.push_back(r1);
+		}
+		if (cached >= 1) {
+			stack.push_back(r0);
+		}
+		cached = 0;
+	}
+
+private:
+	Stack& stack;
+	double r0 = 0;
+	double r1 = 0;
+	int cached = 0;
+};
+
+} // namespace detail
+
+// Runs Programs (and Code) on one stack per type in Types, stored in Storage
+// (Stacks or SlabStacks). A stack that isn't listed takes no memory and is
+// never cleared. get_stack<T> for it is an always empty NullStack, so
+// instructions using it are noops. State has every stack; a number regression
+// can use BasicState<Stacks, double>
+template <template <typename...> class Storage, typename... Types>
+class BasicState {
 public:
-	State() {}
+	// loops available for running a Program
+	enum class Interpreter {
+		dispatch_table, // every instruction reads and writes the stacks in memory
+		cached_top, // keeps the top two number stack items in registers
+	};
+
+	template <typename T>
+	static constexpr bool has_stack = Storage<Types...>::template contains<T>;
+	// whether a push can be dropped, e.g. onto a full slab stack
+	static constexpr bool drops_pushes = Storage<Types...>::drops_pushes;
+
+	BasicState() = default;
+	// capacity of every stack, for slab storage
+	template <template <typename...> class S = Storage,
+		std::enable_if_t<std::is_same_v<S<Types...>, SlabStacks<Types...>>, int> = 0>
+	explicit BasicState(std::size_t capacity) : stacks(capacity) {}
+
+	void set_interpreter(Interpreter interpreter) { this->interpreter = interpreter; }
+	// empty every stack but keep its capacity, so a State reused across runs
+	// stops allocating once its stacks have grown
+	void reset();
+
+	// stop runs once they've charged this many instructions. blocks are charged
+	// in full on entry, see FrameStack
+	void set_effort_limit(std::size_t limit);
+	std::size_t get_effort_limit() const { return effort_limit; }
+	// instructions charged by the last run, and whether it was cut off
+	std::size_t get_effort() const { return frames.get_effort() + closure_frames.get_effort(); }
+	bool exhausted_effort() const { return get_effort() > effort_limit; }
+
+	// stop runs that take longer than limit (0 for no limit). the clock is read
+	// each time check_every more instructions have been charged
+	void set_time_limit(std::chrono::nanoseconds limit, std::size_t check_every = 1'024);
+	// whether the last run was stopped by the time limit
+	bool timed_out() const { return frames.timed_out() || closure_frames.timed_out(); }
+
+	// needs the exec stack
 	void run(const std::vector<std::shared_ptr<Code>> program);
+	void run(const Program& program);
+	void run(const Program& program, const std::vector<double>& inputs);
+	// skips decoding by running a program compiled ahead of time. State only
+	void run(const ClosureProgram& program, const std::vector<double>& inputs = {});
 
-	template <typename T> auto& get_stack() = delete;
+	template <typename T>
+	auto& get_stack() {
+		if constexpr (has_stack<T>) {
+			return stacks.template get<T>();
+		} else {
+			return null_stack<T>;
+		}
+	}
 	template <typename T, typename U> void push(const U item);
 	template <typename T> auto pop();
 
 private:
-	std::vector<std::shared_ptr<Code>> exec_stack;
-	std::vector<double> number_stack;
+	friend class ClosureProgram; // runs on closure_frames and the value stacks
+
+	void run_dispatch_table(const Program& program);
+	void run_cached_top(const Program& program);
+	void push_input(std::size_t n);
+	void push_bool_input(std::size_t n);
+	void exec_if();
+	void start_clock(); // set the deadline for a run starting now
+
+	Interpreter interpreter = Interpreter::dispatch_table;
+	std::size_t effort_limit = std::numeric_limits<std::size_t>::max();
+	std::chrono::nanoseconds time_limit{0};
+	std::size_t check_every = 1'024;
+
+	Storage<Types...> stacks; // the exec stack is for running Code
+	FrameStack frames; // exec stack when running a Program
+	BasicFrameStack<ClosureProgram::Closure> closure_frames; // and when running a ClosureProgram
+
+	// inputs of the Program being run
+	const double* inputs = nullptr;
+	std::size_t num_inputs = 0;
 };
 
-struct Exec;
-template <> inline auto& State::get_stack<Exec>() { return exec_stack; }
-template <> inline auto& State::get_stack<double>() { return number_stack; }
+// keeps its stacks in one allocation. see SlabStacks
+template <typename... Types>
+using SlabState = BasicState<SlabStacks, Types...>;
+
+// instantiated once, in state.cpp
+extern template class BasicState<Stacks, Exec, double, bool>;
 
+template <template <typename...> class Storage, typename... Types>
 template <typename T, typename U>
-void State::push(const U item) {
+void BasicState<Storage, Types...>::push(const U item) {
 	get_stack<T>().push_back(item);
 }
 
+template <template <typename...> class Storage, typename... Types>
 template <typename T>
-auto State::pop() {
+auto BasicState<Storage, Types...>::pop() {
 	auto& stack = get_stack<T>();
-	auto top = stack.back();
+	// copy out of std::vector<bool>'s proxy reference before popping
+	typename std::decay_t<decltype(stack)>::value_type top = stack.back();
 	stack.pop_back();
 	return top;
 }
 
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::run(const std::vector<std::shared_ptr<Code>> prog) {
+	auto& exec_stack = get_stack<Exec>();
+	exec_stack = prog;
+	std::reverse(exec_stack.begin(), exec_stack.end());
+	while (exec_stack.size() > 0) {
+		auto op = exec_stack.back();
+		exec_stack.pop_back();
+		(*op)(*this);
+	}
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::reset() {
+	stacks.clear();
+	frames.clear();
+	closure_frames.clear();
+	inputs = nullptr;
+	num_inputs = 0;
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::set_effort_limit(std::size_t limit) {
+	effort_limit = limit;
+	frames.set_effort_limit(limit);
+	closure_frames.set_effort_limit(limit);
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::set_time_limit(std::chrono::nanoseconds limit, std::size_t check_every) {
+	time_limit = limit;
+	this->check_every = check_every;
+	if (limit == limit.zero()) {
+		frames.set_deadline(CoarseClock::time_point::max(), std::numeric_limits<std::size_t>::max());
+		closure_frames.set_deadline(CoarseClock::time_point::max(), std::numeric_limits<std::size_t>::max());
+	}
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::start_clock() {
+	if (time_limit != time_limit.zero()) {
+		auto deadline = CoarseClock::now() + time_limit;
+		frames.set_deadline(deadline, check_every);
+		closure_frames.set_deadline(deadline, check_every);
+	}
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::run(const Program& program) {
+	run(program, {});
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::run(const Program& program, const std::vector<double>& inputs) {
+	this->inputs = inputs.data();
+	num_inputs = inputs.size();
+
+	start_clock();
+	closure_frames.clear();
+	frames.start(program);
+
+	switch (interpreter) {
+	case Interpreter::dispatch_table:
+		run_dispatch_table(program);
+		break;
+	case Interpreter::cached_top:
+		run_cached_top(program);
+		break;
+	}
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::run(const ClosureProgram& program, const std::vector<double>& inputs) {
+	program.run(*this, inputs);
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::run_dispatch_table(const Program& program) {
+	constexpr auto& op_table = detail::op_table<BasicState>;
+	while (!frames.empty()) {
+		Bytecode insn = frames.next();
+		switch (insn.opcode) {
+		case Opcode::literal:
+			get_stack<double>().push_back(program.number_pool[insn.arg]);
+			break;
+		case Opcode::literal_int:
+		case Opcode::literal_constant:
+			get_stack<double>().push_back(immediate_value(insn));
+			break;
+		case Opcode::block:
+			frames.push(program, program.blocks[insn.arg]);
+			break;
+		case Opcode::input:
+			push_input(insn.arg);
+			break;
+		case Opcode::bool_input:
+			push_bool_input(insn.arg);
+			break;
+		case Opcode::exec_dup:
+			frames.dup_next();
+			break;
+		case Opcode::exec_if:
+			exec_if();
+			break;
+		case Opcode::exec_pop:
+			frames.pop_next();
+			break;
+		// superinstructions run their sequence without returning to dispatch
+		case Opcode::literal_add:
+			get_stack<double>().push_back(program.number_pool[insn.arg]);
+			number_add(*this);
+			break;
+		case Opcode::literal_sub:
+			get_stack<double>().push_back(program.number_pool[insn.arg]);
+			number_sub(*this);
+			break;
+		case Opcode::literal_mul:
+			get_stack<double>().push_back(program.number_pool[insn.arg]);
+			number_mul(*this);
+			break;
+		case Opcode::literal_div:
+			get_stack<double>().push_back(program.number_pool[insn.arg]);
+			number_div(*this);
+			break;
+		case Opcode::literal_mul_add:
+			get_stack<double>().push_back(program.number_pool[insn.arg]);
+			number_mul(*this);
+			number_add(*this);
+			break;
+		case Opcode::input_add:
+			push_input(insn.arg);
+			number_add(*this);
+			break;
+		case Opcode::input_sub:
+			push_input(insn.arg);
+			number_sub(*this);
+			break;
+		case Opcode::input_mul:
+			push_input(insn.arg);
+			number_mul(*this);
+			break;
+		case Opcode::input_div:
+			push_input(insn.arg);
+			number_div(*this);
+			break;
+		case Opcode::input_mul_add:
+			push_input(insn.arg);
+			number_mul(*this);
+			number_add(*this);
+			break;
+		default:
+			op_table[static_cast<std::size_t>(insn.opcode)](*this);
+		}
+	}
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::run_cached_top(const Program& program) {
+	constexpr auto& op_table = detail::op_table<BasicState>;
+	detail::TopCache top(get_stack<double>());
+	while (!frames.empty()) {
+		Bytecode insn = frames.next();
+		switch (insn.opcode) {
+		case Opcode::literal:
+			top.push(program.number_pool[insn.arg]);
+			break;
+		case Opcode::literal_int:
+		case Opcode::literal_constant:
+			top.push(immediate_value(insn));
+			break;
+		case Opcode::block:
+			frames.push(program, program.blocks[insn.arg]);
+			break;
+		case Opcode::input:
+			if (insn.arg < num_inputs) {
+				top.push(inputs[insn.arg]);
+			}
+			break;
+		case Opcode::bool_input:
+			push_bool_input(insn.arg);
+			break;
+		case Opcode::exec_dup:
+			frames.dup_next();
+			break;
+		case Opcode::exec_if:
+			exec_if();
+			break;
+		case Opcode::exec_pop:
+			frames.pop_next();
+			break;
+
+		// the cache checks depth itself, so checked and unchecked variants are the same
+		case Opcode::number_add:
+		case Opcode::number_add_unchecked:
+			top.binary(std::plus<>());
+			break;
+		case Opcode::number_sub:
+		case Opcode::number_sub_unchecked:
+			top.binary(std::minus<>());
+			break;
+		case Opcode::number_mul:
+		case Opcode::number_mul_unchecked:
+			top.binary(std::multiplies<>());
+			break;
+		case Opcode::number_div:
+		case Opcode::number_div_unchecked:
+			top.binary(std::divides<>());
+			break;
+		case Opcode::number_mod:
+		case Opcode::number_mod_unchecked:
+			top.binary([](double a, double b) { return std::fmod(a, b); });
+			break;
+		case Opcode::number_max:
+		case Opcode::number_max_unchecked:
+			top.binary([](double a, double b) { return std::max(a, b); });
+			break;
+		case Opcode::number_min:
+		case Opcode::number_min_unchecked:
+			top.binary([](double a, double b) { return std::min(a, b); });
+			break;
+		case Opcode::number_cos:
+		case Opcode::number_cos_unchecked:
+			top.unary([](double a) { return std::cos(a); });
+			break;
+		case Opcode::number_sin:
+		case Opcode::number_sin_unchecked:
+			top.unary([](double a) { return std::sin(a); });
+			break;
+		case Opcode::number_tan:
+		case Opcode::number_tan_unchecked:
+			top.unary([](double a) { return std::tan(a); });
+			break;
+
+		case Opcode::literal_add:
+			top.push(program.number_pool[insn.arg]);
+			top.binary(std::plus<>());
+			break;
+		case Opcode::literal_sub:
+			top.push(program.number_pool[insn.arg]);
+			top.binary(std::minus<>());
+			break;
+		case Opcode::literal_mul:
+			top.push(program.number_pool[insn.arg]);
+			top.binary(std::multiplies<>());
+			break;
+		case Opcode::literal_div:
+			top.push(program.number_pool[insn.arg]);
+			top.binary(std::divides<>());
+			break;
+		case Opcode::literal_mul_add:
+			top.push(program.number_pool[insn.arg]);
+			top.binary(std::multiplies<>());
+			top.binary(std::plus<>());
+			break;
+		case Opcode::input_add:
+			if (insn.arg < num_inputs) {
+				top.push(inputs[insn.arg]);
+			}
+			top.binary(std::plus<>());
+			break;
+		case Opcode::input_sub:
+			if (insn.arg < num_inputs) {
+				top.push(inputs[insn.arg]);
+			}
+			top.binary(std::minus<>());
+			break;
+		case Opcode::input_mul:
+			if (insn.arg < num_inputs) {
+				top.push(inputs[insn.arg]);
+			}
+			top.binary(std::multiplies<>());
+			break;
+		case Opcode::input_div:
+			if (insn.arg < num_inputs) {
+				top.push(inputs[insn.arg]);
+			}
+			top.binary(std::divides<>());
+			break;
+		case Opcode::input_mul_add:
+			if (insn.arg < num_inputs) {
+				top.push(inputs[insn.arg]);
+			}
+			top.binary(std::multiplies<>());
+			top.binary(std::plus<>());
+			break;
+
+		default:
+			top.spill();
+			op_table[static_cast<std::size_t>(insn.opcode)](*this);
+		}
+	}
+	top.spill();
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::exec_if() {
+	if (frames.has_two_items() && !get_stack<bool>().empty()) {
+		if (pop<bool>()) {
+			frames.skip_second();
+		} else {
+			frames.pop_next();
+		}
+	}
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::push_input(std::size_t n) {
+	if (n < num_inputs) {
+		get_stack<double>().push_back(inputs[n]);
+	}
+}
+
+template <template <typename...> class Storage, typename... Types>
+void BasicState<Storage, Types...>::push_bool_input(std::size_t n) {
+	if (n < num_inputs) {
+		get_stack<bool>().push_back(inputs[n] != 0);
+	}
+}
+
 } // namespace cppush
 
-#endif // STATE_H
\ No newline at end of file
+#endif // STATE_H
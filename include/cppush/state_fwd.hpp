@@ -0,0 +1,15 @@
+#ifndef STATE_FWD_H
+#define STATE_FWD_H
+
+namespace cppush {
+
+template <typename... Types> class Stacks;
+template <template <typename...> class Storage, typename... Types> class BasicState;
+struct Exec; // tag for the exec stack of Code
+
+// every stack, in vectors. see state.hpp
+using State = BasicState<Stacks, Exec, double, bool>;
+
+} // namespace cppush
+
+#endif // STATE_FWD_H
@@ -0,0 +1,65 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cppush {
+
+// Runs parallel loops on a fixed set of threads. Each worker starts with an
+// even share of the indices and, once it runs out, steals half of what's left
+// of another worker's share, so skewed run times still keep every thread busy.
+// Shares are claimed with compare-and-swap, without locks
+class ThreadPool {
+public:
+	// 0 for one worker per hardware thread. the thread calling run() is worker 0
+	explicit ThreadPool(unsigned workers = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned size() const { return num_workers; }
+
+	// call body(index, worker) for every index in [0, count) and return once
+	// they've all finished. worker is in [0, size()), and calls with the same
+	// worker never overlap, so it can index per-thread scratch space. rethrows
+	// the first exception body throws, after the rest of the loop has run
+	void run(std::size_t count, const std::function<void(std::size_t, unsigned)>& body);
+
+private:
+	// the unclaimed indices [begin, end) of a worker's share, packed as
+	// begin << 32 | end so both change in one atomic operation
+	struct alignas(64) Share {
+		std::atomic<std::uint64_t> bounds{0};
+	};
+
+	void thread_main(unsigned worker);
+	void work(unsigned worker);
+	bool claim(unsigned worker, std::size_t& index);
+	bool steal(unsigned worker, std::size_t& index);
+
+	unsigned num_workers;
+	std::unique_ptr<Share[]> shares;
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable started;
+	std::condition_variable finished;
+	const std::function<void(std::size_t, unsigned)>* body = nullptr;
+	std::size_t loop = 0; // incremented for each run(), to wake the threads
+	unsigned running = 0; // threads still working on the current loop
+	bool stopping = false;
+	std::exception_ptr error;
+};
+
+} // namespace cppush
+
+#endif // THREAD_POOL_H
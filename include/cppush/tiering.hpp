@@ -0,0 +1,56 @@
+#ifndef TIERING_H
+#define TIERING_H
+
+#include "closures.hpp"
+#include "jit.hpp"
+#include "program.hpp"
+#include "state.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace cppush {
+
+// engines a TieredProgram can run on, slowest to start up first
+enum class Tier {
+	interpreter, // State::run on the bytecode. nothing to compile
+	closures, // ClosureProgram
+	native, // NativeProgram, for programs and platforms the JIT supports
+};
+constexpr std::size_t tier_count = 3;
+
+// A Program that runs on the interpreter until promote() compiles it to the
+// fastest tier that supports it. Several threads can run it at once, each on
+// its own State, but not while it's being promoted
+class TieredProgram {
+public:
+	explicit TieredProgram(Program program);
+
+	const Program& get_program() const { return program; }
+	Tier get_tier() const { return tier; }
+	// number of times the program has been run
+	std::size_t get_runs() const { return runs.load(std::memory_order_relaxed); }
+
+	// compile for running with `inputs` inputs. other input counts still work
+	// but skip the native tier
+	void promote(std::size_t inputs);
+
+	// top of the number stack (NaN if empty) after running on inputs. state is
+	// reset first, so one State can be reused for every run without allocating.
+	// its effort and time limits bound the run
+	double run(State& state, const std::vector<double>& inputs);
+
+private:
+	Program program;
+	Tier tier = Tier::interpreter;
+	std::atomic<std::size_t> runs{0}; // cases of one program can run on several threads
+	std::unique_ptr<ClosureProgram> closures;
+	std::unique_ptr<NativeProgram> native;
+	std::size_t native_inputs = 0;
+};
+
+} // namespace cppush
+
+#endif // TIERING_H
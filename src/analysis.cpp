@@ -0,0 +1,226 @@
+#include "cppush/analysis.hpp"
+
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace cppush {
+
+namespace {
+
+// what a number instruction requires of the stack and its net effect when it runs
+struct StackEffect {
+	std::size_t needs;
+	int delta;
+};
+
+bool is_number_op(Opcode opcode) {
+	return opcode >= Opcode::number_add && opcode <= Opcode::number_tan;
+}
+
+StackEffect effect(Opcode opcode) {
+	switch (opcode) {
+	case Opcode::number_cos:
+	case Opcode::number_sin:
+	case Opcode::number_tan:
+	case Opcode::number_cos_unchecked:
+	case Opcode::number_sin_unchecked:
+	case Opcode::number_tan_unchecked:
+		return {1, 0};
+	case Opcode::number_lt:
+	case Opcode::number_gt:
+		return {2, -2};
+	case Opcode::bool_input:
+	case Opcode::bool_and:
+	case Opcode::bool_or:
+	case Opcode::bool_not:
+	case Opcode::bool_nand:
+	case Opcode::bool_nor:
+	case Opcode::bool_xor:
+	case Opcode::bool_invert_first_then_and:
+	case Opcode::bool_invert_second_then_and:
+		return {0, 0};
+	default:
+		return {2, -1};
+	}
+}
+
+// minimum depth after a number instruction. if the stack may be too shallow
+// the instruction may be a noop instead
+std::size_t apply(std::size_t depth, StackEffect effect) {
+	std::size_t after_run = effect.needs + effect.delta;
+	return depth >= effect.needs ? depth + effect.delta : std::min(depth, after_run);
+}
+
+class Analysis {
+public:
+	Analysis(const Program& program, std::size_t inputs) :
+		program(program),
+		inputs(inputs),
+		depths(program.code.size(), unvisited),
+		active(program.blocks.size(), false) {}
+
+	std::vector<std::size_t> run() {
+		if (!program.blocks.empty()) {
+			walk(0, 0);
+		}
+		for (auto& depth : depths) {
+			// unreachable code, or blocks that (indirectly) contain themselves
+			if (depth == unvisited || cyclic) {
+				depth = 0;
+			}
+		}
+		return depths;
+	}
+
+private:
+	struct Exit {
+		std::size_t depth;
+		bool redirects; // an exec instruction may skip or repeat code following the block
+	};
+
+	Exit walk(std::size_t index, std::size_t depth) {
+		if (active[index]) {
+			cyclic = true;
+			return {0, true};
+		}
+		active[index] = true;
+
+		// once an exec instruction may skip or repeat the items after it, an
+		// item may run any number of times so there's no depth to carry over
+		bool redirects = false;
+		Block block = program.blocks[index];
+		for (std::size_t i = block.begin; i < block.end; ++i) {
+			depths[i] = std::min(depths[i], depth);
+			depth = step(program.code[i], depth, redirects);
+			if (redirects) {
+				depth = 0;
+			}
+		}
+
+		active[index] = false;
+		return {depth, redirects};
+	}
+
+	// depth after insn. sets redirects if it may skip or repeat following instructions
+	std::size_t step(Bytecode insn, std::size_t depth, bool& redirects) {
+		switch (insn.opcode) {
+		case Opcode::literal:
+		case Opcode::literal_int:
+		case Opcode::literal_constant:
+			return depth + 1;
+		case Opcode::input:
+			return depth + (insn.arg < inputs);
+		case Opcode::block:
+		{
+			Exit exit = walk(insn.arg, depth);
+			redirects = redirects || exit.redirects;
+			return exit.depth;
+		}
+		case Opcode::exec_dup:
+		case Opcode::exec_if:
+		case Opcode::exec_pop:
+			redirects = true;
+			return 0;
+		case Opcode::literal_add:
+		case Opcode::literal_sub:
+		case Opcode::literal_mul:
+		case Opcode::literal_div:
+			return apply(depth + 1, {2, -1});
+		case Opcode::literal_mul_add:
+			return apply(apply(depth + 1, {2, -1}), {2, -1});
+		case Opcode::input_add:
+		case Opcode::input_sub:
+		case Opcode::input_mul:
+		case Opcode::input_div:
+			return apply(depth + (insn.arg < inputs), {2, -1});
+		case Opcode::input_mul_add:
+			return apply(apply(depth + (insn.arg < inputs), {2, -1}), {2, -1});
+		default:
+			return apply(depth, effect(insn.opcode));
+		}
+	}
+
+	static constexpr std::size_t unvisited = std::numeric_limits<std::size_t>::max();
+
+	const Program& program;
+	std::size_t inputs;
+	std::vector<std::size_t> depths;
+	std::vector<bool> active; // blocks currently being walked
+	bool cyclic = false;
+};
+
+} // namespace
+
+bool is_exec_instruction(Opcode opcode) {
+	return opcode == Opcode::exec_dup || opcode == Opcode::exec_if || opcode == Opcode::exec_pop;
+}
+
+bool is_straight_line(const Program& program) {
+	auto straight = [](Bytecode insn) {
+		Opcode opcode = insn.opcode;
+		return opcode == Opcode::literal || opcode == Opcode::literal_int || opcode == Opcode::literal_constant
+			|| opcode == Opcode::block || opcode == Opcode::input
+			|| (opcode >= Opcode::number_add && opcode <= Opcode::number_gt)
+			|| (opcode >= Opcode::literal_add && opcode <= Opcode::input_mul_add)
+			|| (opcode >= Opcode::number_add_unchecked && opcode <= Opcode::number_tan_unchecked);
+	};
+	// with no exec instructions, only recursion makes a block redirect
+	return !program.blocks.empty()
+		&& std::all_of(program.code.begin(), program.code.end(), straight)
+		&& !redirecting_blocks(program)[0];
+}
+
+std::vector<bool> redirecting_blocks(const Program& program) {
+	enum class Mark { unvisited, active, done };
+	std::vector<Mark> marks(program.blocks.size(), Mark::unvisited);
+	std::vector<bool> redirects(program.blocks.size(), false);
+
+	std::function<bool(std::size_t)> visit = [&](std::size_t index) -> bool {
+		if (marks[index] == Mark::active) {
+			return true; // recursive blocks can loop, which counts as repeating code
+		} else if (marks[index] == Mark::done) {
+			return redirects[index];
+		}
+		marks[index] = Mark::active;
+		bool result = false;
+		Block block = program.blocks[index];
+		for (std::size_t i = block.begin; i < block.end; ++i) {
+			Bytecode insn = program.code[i];
+			if (is_exec_instruction(insn.opcode) || (insn.opcode == Opcode::block && visit(insn.arg))) {
+				result = true;
+			}
+		}
+		marks[index] = Mark::done;
+		redirects[index] = result;
+		return result;
+	};
+
+	for (std::size_t i = 0; i < program.blocks.size(); ++i) {
+		visit(i);
+	}
+	return redirects;
+}
+
+std::vector<std::size_t> min_depths(const Program& program, std::size_t inputs) {
+	return Analysis(program, inputs).run();
+}
+
+void elide_checks(Program& program, std::size_t inputs) {
+	auto depths = min_depths(program, inputs);
+	constexpr auto offset = static_cast<int>(Opcode::number_add_unchecked) - static_cast<int>(Opcode::number_add);
+
+	for (std::size_t i = 0; i < program.code.size(); ++i) {
+		Opcode& opcode = program.code[i].opcode;
+		if (is_number_op(opcode) && depths[i] >= effect(opcode).needs) {
+			opcode = static_cast<Opcode>(static_cast<int>(opcode) + offset);
+		}
+	}
+}
+
+} // namespace cppush
@@ -0,0 +1,490 @@
+#include "cppush/batch.hpp"
+
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+#include "cppush/state.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace cppush {
+
+namespace {
+
+using Lanes = BatchState::Lanes;
+
+Lanes broadcast(double value) {
+	Lanes lanes;
+	lanes.fill(value);
+	return lanes;
+}
+
+template <typename Stack, typename F>
+void binary(Stack& stack, F f) {
+	if (stack.size() >= 2) {
+		Lanes b = stack.back();
+		stack.pop_back();
+		Lanes& a = stack.back();
+		for (std::size_t i = 0; i < BatchState::lanes; ++i) {
+			a[i] = f(a[i], b[i]);
+		}
+	}
+}
+
+// pop two numbers a, b and push the mask of lanes where f(a, b) holds
+template <typename Numbers, typename Bools, typename F>
+void compare(Numbers& numbers, Bools& bools, F f) {
+	if (numbers.size() >= 2) {
+		Lanes b = numbers.back();
+		numbers.pop_back();
+		Lanes a = numbers.back();
+		numbers.pop_back();
+		BatchState::Mask mask = 0;
+		for (std::size_t i = 0; i < BatchState::lanes; ++i) {
+			mask |= BatchState::Mask(f(a[i], b[i])) << i;
+		}
+		bools.push_back(mask);
+	}
+}
+
+// bool stack items are masks, so bool ops work on every lane at once. bits of
+// lanes outside the group are don't-cares
+template <typename Stack, typename F>
+void logic(Stack& stack, F f) {
+	if (stack.size() >= 2) {
+		BatchState::Mask b = stack.back();
+		stack.pop_back();
+		stack.back() = f(stack.back(), b);
+	}
+}
+
+template <typename Stack, typename F>
+void unary(Stack& stack, F f) {
+	if (!stack.empty()) {
+		Lanes& a = stack.back();
+		for (std::size_t i = 0; i < BatchState::lanes; ++i) {
+			a[i] = f(a[i]);
+		}
+	}
+}
+
+bool supports(Opcode opcode) {
+	switch (opcode) {
+	case Opcode::literal:
+	case Opcode::literal_int:
+	case Opcode::literal_constant:
+	case Opcode::block:
+	case Opcode::input:
+	case Opcode::bool_input:
+	case Opcode::exec_dup:
+	case Opcode::exec_if:
+	case Opcode::exec_pop:
+	case Opcode::number_add:
+	case Opcode::number_sub:
+	case Opcode::number_mul:
+	case Opcode::number_div:
+	case Opcode::number_mod:
+	case Opcode::number_max:
+	case Opcode::number_min:
+	case Opcode::number_cos:
+	case Opcode::number_sin:
+	case Opcode::number_tan:
+	case Opcode::number_lt:
+	case Opcode::number_gt:
+	case Opcode::bool_and:
+	case Opcode::bool_or:
+	case Opcode::bool_not:
+	case Opcode::bool_nand:
+	case Opcode::bool_nor:
+	case Opcode::bool_xor:
+	case Opcode::bool_invert_first_then_and:
+	case Opcode::bool_invert_second_then_and:
+	case Opcode::literal_add:
+	case Opcode::literal_sub:
+	case Opcode::literal_mul:
+	case Opcode::literal_div:
+	case Opcode::literal_mul_add:
+	case Opcode::input_add:
+	case Opcode::input_sub:
+	case Opcode::input_mul:
+	case Opcode::input_div:
+	case Opcode::input_mul_add:
+	case Opcode::number_add_unchecked:
+	case Opcode::number_sub_unchecked:
+	case Opcode::number_mul_unchecked:
+	case Opcode::number_div_unchecked:
+	case Opcode::number_mod_unchecked:
+	case Opcode::number_max_unchecked:
+	case Opcode::number_min_unchecked:
+	case Opcode::number_cos_unchecked:
+	case Opcode::number_sin_unchecked:
+	case Opcode::number_tan_unchecked:
+		return true;
+	default:
+		return false;
+	}
+}
+
+double fmod(double a, double b) { return std::fmod(a, b); }
+double max(double a, double b) { return std::max(a, b); }
+double min(double a, double b) { return std::min(a, b); }
+double cos(double a) { return std::cos(a); }
+double sin(double a) { return std::sin(a); }
+double tan(double a) { return std::tan(a); }
+
+} // namespace
+
+bool BatchState::supports(const Program& program) {
+	return std::all_of(program.code.begin(), program.code.end(), [](Bytecode insn) {
+		return cppush::supports(insn.opcode);
+	});
+}
+
+void BatchState::run(const Program& program, const std::vector<Lanes>& inputs) {
+	this->program = &program;
+	this->inputs = &inputs;
+
+	Group all{(Mask(1) << lanes) - 1, {}, {}, {}};
+	// groups copy their frames when they split, so every lane keeps its own count
+	all.frames.set_effort_limit(effort_limit);
+	all.frames.start(program);
+	cut_lanes = 0;
+	finished.clear();
+	regions.clear();
+	free_regions.clear();
+	work.push_back({std::move(all), top});
+
+	while (!work.empty()) {
+		Task task = std::move(work.back());
+		work.pop_back();
+		const FrameStack* join = task.region == top ? nullptr : &regions[task.region].join;
+		if (Mask taken = execute(task.group, join)) {
+			split(std::move(task.group), taken, task.region);
+		} else {
+			arrive(std::move(task.group), task.region);
+		}
+	}
+}
+
+double BatchState::top_number(std::size_t lane) const {
+	for (const auto& group : finished) {
+		if (group.mask & (Mask(1) << lane)) {
+			return group.number_stack.empty()
+				? std::numeric_limits<double>::quiet_NaN()
+				: group.number_stack.top()[lane];
+		}
+	}
+	return std::numeric_limits<double>::quiet_NaN();
+}
+
+BatchState::Mask BatchState::execute(Group& group, const FrameStack* join) {
+	auto& frames = group.frames;
+	auto& number_stack = group.number_stack;
+	auto& bool_stack = group.bool_stack;
+	const auto& pool = program->number_pool;
+	auto push_input = [&](std::size_t n) {
+		if (n < inputs->size()) {
+			number_stack.push_back((*inputs)[n]);
+		}
+	};
+
+	while (!frames.empty() && !(join && frames == *join)) {
+		Bytecode insn = frames.next();
+		switch (insn.opcode) {
+		case Opcode::literal:
+			number_stack.push_back(broadcast(pool[insn.arg]));
+			break;
+		case Opcode::literal_int:
+		case Opcode::literal_constant:
+			number_stack.push_back(broadcast(immediate_value(insn)));
+			break;
+		case Opcode::block:
+			frames.push(*program, program->blocks[insn.arg]);
+			break;
+		case Opcode::input:
+			push_input(insn.arg);
+			break;
+		case Opcode::bool_input:
+			if (insn.arg < inputs->size()) {
+				Mask mask = 0;
+				for (std::size_t i = 0; i < lanes; ++i) {
+					mask |= Mask((*inputs)[insn.arg][i] != 0) << i;
+				}
+				bool_stack.push_back(mask);
+			}
+			break;
+		case Opcode::exec_dup:
+			frames.dup_next();
+			break;
+		case Opcode::exec_if:
+			if (frames.has_two_items() && !bool_stack.empty()) {
+				Mask taken = bool_stack.back() & group.mask;
+				bool_stack.pop_back();
+				if (taken == group.mask) {
+					frames.skip_second();
+				} else if (taken == 0) {
+					frames.pop_next();
+				} else {
+					return taken;
+				}
+			}
+			break;
+		case Opcode::exec_pop:
+			frames.pop_next();
+			break;
+		// stack depth is the same in every lane of a group, so checking it once covers them all
+		case Opcode::number_add:
+		case Opcode::number_add_unchecked:
+			binary(number_stack, std::plus<>());
+			break;
+		case Opcode::number_sub:
+		case Opcode::number_sub_unchecked:
+			binary(number_stack, std::minus<>());
+			break;
+		case Opcode::number_mul:
+		case Opcode::number_mul_unchecked:
+			binary(number_stack, std::multiplies<>());
+			break;
+		case Opcode::number_div:
+		case Opcode::number_div_unchecked:
+			binary(number_stack, std::divides<>());
+			break;
+		case Opcode::number_mod:
+		case Opcode::number_mod_unchecked:
+			binary(number_stack, fmod);
+			break;
+		case Opcode::number_max:
+		case Opcode::number_max_unchecked:
+			binary(number_stack, max);
+			break;
+		case Opcode::number_min:
+		case Opcode::number_min_unchecked:
+			binary(number_stack, min);
+			break;
+		case Opcode::number_cos:
+		case Opcode::number_cos_unchecked:
+			unary(number_stack, cos);
+			break;
+		case Opcode::number_sin:
+		case Opcode::number_sin_unchecked:
+			unary(number_stack, sin);
+			break;
+		case Opcode::number_tan:
+		case Opcode::number_tan_unchecked:
+			unary(number_stack, tan);
+			break;
+		case Opcode::number_lt:
+			compare(number_stack, bool_stack, std::less<>());
+			break;
+		case Opcode::number_gt:
+			compare(number_stack, bool_stack, std::greater<>());
+			break;
+		case Opcode::bool_and:
+			logic(bool_stack, [](Mask a, Mask b) { return a & b; });
+			break;
+		case Opcode::bool_or:
+			logic(bool_stack, [](Mask a, Mask b) { return a | b; });
+			break;
+		case Opcode::bool_not:
+			if (!bool_stack.empty()) {
+				bool_stack.back() = ~bool_stack.back();
+			}
+			break;
+		case Opcode::bool_nand:
+			logic(bool_stack, [](Mask a, Mask b) { return ~(a & b); });
+			break;
+		case Opcode::bool_nor:
+			logic(bool_stack, [](Mask a, Mask b) { return ~(a | b); });
+			break;
+		case Opcode::bool_xor:
+			logic(bool_stack, [](Mask a, Mask b) { return a ^ b; });
+			break;
+		case Opcode::bool_invert_first_then_and:
+			logic(bool_stack, [](Mask a, Mask b) { return a & ~b; });
+			break;
+		case Opcode::bool_invert_second_then_and:
+			logic(bool_stack, [](Mask a, Mask b) { return ~a & b; });
+			break;
+
+		case Opcode::literal_add:
+			number_stack.push_back(broadcast(pool[insn.arg]));
+			binary(number_stack, std::plus<>());
+			break;
+		case Opcode::literal_sub:
+			number_stack.push_back(broadcast(pool[insn.arg]));
+			binary(number_stack, std::minus<>());
+			break;
+		case Opcode::literal_mul:
+			number_stack.push_back(broadcast(pool[insn.arg]));
+			binary(number_stack, std::multiplies<>());
+			break;
+		case Opcode::literal_div:
+			number_stack.push_back(broadcast(pool[insn.arg]));
+			binary(number_stack, std::divides<>());
+			break;
+		case Opcode::literal_mul_add:
+			number_stack.push_back(broadcast(pool[insn.arg]));
+			binary(number_stack, std::multiplies<>());
+			binary(number_stack, std::plus<>());
+			break;
+		case Opcode::input_add:
+			push_input(insn.arg);
+			binary(number_stack, std::plus<>());
+			break;
+		case Opcode::input_sub:
+			push_input(insn.arg);
+			binary(number_stack, std::minus<>());
+			break;
+		case Opcode::input_mul:
+			push_input(insn.arg);
+			binary(number_stack, std::multiplies<>());
+			break;
+		case Opcode::input_div:
+			push_input(insn.arg);
+			binary(number_stack, std::divides<>());
+			break;
+		case Opcode::input_mul_add:
+			push_input(insn.arg);
+			binary(number_stack, std::multiplies<>());
+			binary(number_stack, std::plus<>());
+			break;
+
+		default:
+			break; // rejected by supports()
+		}
+	}
+	if (frames.cut_off()) {
+		cut_lanes |= group.mask;
+	}
+	return 0;
+}
+
+void BatchState::split(Group group, Mask taken, std::size_t region) {
+	// both branches end up here once they've run their item
+	FrameStack after = group.frames;
+	after.pop_next();
+	after.pop_next();
+
+	group.number_stack.share();
+	group.bool_stack.share();
+	Group other = group;
+	other.mask &= ~taken;
+	other.frames.pop_next();
+	group.mask = taken;
+	group.frames.skip_second();
+
+	// the new region stands in for group in its parent until it's done
+	std::size_t inner;
+	if (free_regions.empty()) {
+		inner = regions.size();
+		regions.push_back({std::move(after), region, 2, {}});
+	} else {
+		inner = free_regions.back();
+		free_regions.pop_back();
+		regions[inner].join = std::move(after);
+		regions[inner].parent = region;
+		regions[inner].running = 2;
+	}
+	work.push_back({std::move(other), inner});
+	work.push_back({std::move(group), inner});
+}
+
+void BatchState::arrive(Group group, std::size_t region) {
+	if (region == top) {
+		finished.push_back(std::move(group));
+		return;
+	}
+	Region& current = regions[region];
+	current.arrived.push_back(std::move(group));
+	if (--current.running > 0) {
+		return;
+	}
+
+	// reconverge groups that reached the same point with the same stack shapes.
+	// a group has one effort count, so under a limit they must also have
+	// charged the same to stay cut off where State would
+	bool limited = effort_limit != std::numeric_limits<std::size_t>::max();
+	auto& arrived = current.arrived;
+	for (std::size_t i = 0; i < arrived.size(); ++i) {
+		for (std::size_t j = i + 1; j < arrived.size(); ++j) {
+			Group& a = arrived[i];
+			Group& b = arrived[j];
+			if (a.frames != b.frames
+					|| a.number_stack.size() != b.number_stack.size()
+					|| a.bool_stack.size() != b.bool_stack.size()
+					|| (limited && a.frames.get_effort() != b.frames.get_effort())) {
+				continue;
+			}
+			a.number_stack.blend(b.number_stack, [&](Lanes& ours, const Lanes& theirs) {
+				for (std::size_t lane = 0; lane < lanes; ++lane) {
+					if (b.mask & (Mask(1) << lane)) {
+						ours[lane] = theirs[lane];
+					}
+				}
+			});
+			a.bool_stack.blend(b.bool_stack, [&](Mask& ours, Mask theirs) {
+				ours = (ours & ~b.mask) | (theirs & b.mask);
+			});
+			a.mask |= b.mask;
+			arrived.erase(arrived.begin() + j);
+			--j;
+		}
+	}
+
+	if (current.parent != top) {
+		regions[current.parent].running += arrived.size() - 1;
+	}
+	for (auto& arrival : arrived) {
+		work.push_back({std::move(arrival), current.parent});
+	}
+	arrived.clear();
+	free_regions.push_back(region);
+}
+
+std::vector<double> run_cases(const Program& program, const std::vector<std::vector<double>>& cases, std::size_t effort_limit) {
+	constexpr double empty = std::numeric_limits<double>::quiet_NaN();
+	std::vector<double> results(cases.size(), empty);
+
+	// a missing input is a noop, so lanes with different input counts diverge
+	bool uniform_inputs = std::all_of(cases.begin(), cases.end(), [&](const auto& inputs) {
+		return inputs.size() == cases[0].size();
+	});
+	if (!uniform_inputs || !BatchState::supports(program)) {
+		for (std::size_t i = 0; i < cases.size(); ++i) {
+			State state;
+			state.set_effort_limit(effort_limit);
+			state.run(program, cases[i]);
+			const auto& stack = state.get_stack<double>();
+			if (!stack.empty()) {
+				results[i] = stack.back();
+			}
+		}
+		return results;
+	}
+
+	BatchState batch;
+	batch.set_effort_limit(effort_limit);
+	std::vector<BatchState::Lanes> inputs(cases.empty() ? 0 : cases[0].size());
+	for (std::size_t first = 0; first < cases.size(); first += BatchState::lanes) {
+		// spare lanes in the last batch repeat its first case
+		for (std::size_t lane = 0; lane < BatchState::lanes; ++lane) {
+			std::size_t index = first + lane < cases.size() ? first + lane : first;
+			for (std::size_t i = 0; i < inputs.size(); ++i) {
+				inputs[i][lane] = cases[index][i];
+			}
+		}
+
+		batch.run(program, inputs);
+		for (std::size_t lane = 0; lane < BatchState::lanes && first + lane < cases.size(); ++lane) {
+			results[first + lane] = batch.top_number(lane);
+		}
+	}
+	return results;
+}
+
+} // namespace cppush
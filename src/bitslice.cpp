@@ -0,0 +1,166 @@
+#include "cppush/bitslice.hpp"
+
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+#include "cppush/state.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace cppush {
+
+namespace {
+
+using Word = BitsliceState::Word;
+
+bool supports(Opcode opcode) {
+	switch (opcode) {
+	case Opcode::block:
+	case Opcode::bool_input:
+	case Opcode::exec_dup:
+	case Opcode::exec_pop:
+	case Opcode::bool_and:
+	case Opcode::bool_or:
+	case Opcode::bool_not:
+	case Opcode::bool_nand:
+	case Opcode::bool_nor:
+	case Opcode::bool_xor:
+	case Opcode::bool_invert_first_then_and:
+	case Opcode::bool_invert_second_then_and:
+		return true;
+	default:
+		return false;
+	}
+}
+
+template <typename F>
+void binary(std::vector<Word>& stack, F f) {
+	if (stack.size() >= 2) {
+		Word b = stack.back();
+		stack.pop_back();
+		stack.back() = f(stack.back(), b);
+	}
+}
+
+// bit r of the word is bit i of r, for the 64 rows of a word
+constexpr Word row_bits[] = {
+	0xaaaaaaaaaaaaaaaa,
+	0xcccccccccccccccc,
+	0xf0f0f0f0f0f0f0f0,
+	0xff00ff00ff00ff00,
+	0xffff0000ffff0000,
+	0xffffffff00000000,
+};
+
+} // namespace
+
+bool BitsliceState::supports(const Program& program) {
+	return std::all_of(program.code.begin(), program.code.end(), [](Bytecode insn) {
+		return cppush::supports(insn.opcode);
+	});
+}
+
+void BitsliceState::run(const Program& program, const std::vector<Word>& inputs) {
+	frames.start(program);
+	bool_stack.clear();
+
+	while (!frames.empty()) {
+		Bytecode insn = frames.next();
+		switch (insn.opcode) {
+		case Opcode::block:
+			frames.push(program, program.blocks[insn.arg]);
+			break;
+		case Opcode::bool_input:
+			if (insn.arg < inputs.size()) {
+				bool_stack.push_back(inputs[insn.arg]);
+			}
+			break;
+		case Opcode::exec_dup:
+			frames.dup_next();
+			break;
+		case Opcode::exec_pop:
+			frames.pop_next();
+			break;
+		case Opcode::bool_and:
+			binary(bool_stack, [](Word a, Word b) { return a & b; });
+			break;
+		case Opcode::bool_or:
+			binary(bool_stack, [](Word a, Word b) { return a | b; });
+			break;
+		case Opcode::bool_not:
+			if (!bool_stack.empty()) {
+				bool_stack.back() = ~bool_stack.back();
+			}
+			break;
+		case Opcode::bool_nand:
+			binary(bool_stack, [](Word a, Word b) { return ~(a & b); });
+			break;
+		case Opcode::bool_nor:
+			binary(bool_stack, [](Word a, Word b) { return ~(a | b); });
+			break;
+		case Opcode::bool_xor:
+			binary(bool_stack, [](Word a, Word b) { return a ^ b; });
+			break;
+		case Opcode::bool_invert_first_then_and:
+			binary(bool_stack, [](Word a, Word b) { return a & ~b; });
+			break;
+		case Opcode::bool_invert_second_then_and:
+			binary(bool_stack, [](Word a, Word b) { return ~a & b; });
+			break;
+		default:
+			break; // rejected by supports()
+		}
+	}
+}
+
+std::vector<Word> run_truth_table(const Program& program, std::size_t inputs, std::size_t effort_limit) {
+	constexpr std::size_t row_inputs = sizeof(row_bits) / sizeof(row_bits[0]);
+	if (inputs >= 32) {
+		throw std::length_error("truth table has too many rows");
+	}
+	std::size_t rows = std::size_t(1) << inputs;
+	std::vector<Word> table((rows + BitsliceState::lanes - 1) / BitsliceState::lanes, 0);
+
+	if (!BitsliceState::supports(program)) {
+		std::vector<double> values(inputs);
+		for (std::size_t row = 0; row < rows; ++row) {
+			for (std::size_t i = 0; i < inputs; ++i) {
+				values[i] = (row >> i) & 1;
+			}
+			State state;
+			state.set_effort_limit(effort_limit);
+			state.run(program, values);
+			const auto& stack = state.get_stack<bool>();
+			if (!stack.empty() && stack.back()) {
+				table[row / BitsliceState::lanes] |= Word(1) << (row % BitsliceState::lanes);
+			}
+		}
+		return table;
+	}
+
+	BitsliceState state;
+	state.set_effort_limit(effort_limit);
+	std::vector<Word> words(inputs);
+	// a word's rows only differ in their low bits, the rest come from its index
+	for (std::size_t i = 0; i < inputs && i < row_inputs; ++i) {
+		words[i] = row_bits[i];
+	}
+	for (std::size_t w = 0; w < table.size(); ++w) {
+		for (std::size_t i = row_inputs; i < inputs; ++i) {
+			words[i] = (w >> (i - row_inputs)) & 1 ? ~Word(0) : 0;
+		}
+		state.run(program, words);
+		if (!state.get_bool_stack().empty()) {
+			table[w] = state.get_bool_stack().back();
+		}
+	}
+	// tables under a word long only use its low bits
+	if (rows < BitsliceState::lanes) {
+		table[0] &= (Word(1) << rows) - 1;
+	}
+	return table;
+}
+
+} // namespace cppush
@@ -0,0 +1,282 @@
+#include "cppush/closures.hpp"
+
+#include "cppush/analysis.hpp"
+#include "cppush/frame_stack.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+#include "cppush/state.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace cppush {
+
+using Closure = ClosureProgram::Closure;
+using Machine = ClosureProgram::Machine;
+
+struct ClosureProgram::Closure {
+	void (*run)(Machine& machine, const Closure& closure) = nullptr;
+	double value = 0; // literal value
+	std::size_t arg = 0; // input index
+	const Closure* begin = nullptr; // block contents
+	const Closure* end = nullptr;
+};
+
+struct ClosureProgram::Machine {
+	std::vector<double>& number_stack;
+	std::vector<bool>& bool_stack;
+	const double* inputs;
+	std::size_t num_inputs;
+	BasicFrameStack<Closure>& frames;
+};
+
+namespace {
+
+// number and bool ops, computing exactly what number_ops.hpp and boolean_ops.hpp do
+struct Fmod { double operator()(double a, double b) const { return std::fmod(a, b); } };
+struct Max { double operator()(double a, double b) const { return std::max(a, b); } };
+struct Min { double operator()(double a, double b) const { return std::min(a, b); } };
+struct Cos { double operator()(double a) const { return std::cos(a); } };
+struct Sin { double operator()(double a) const { return std::sin(a); } };
+struct Tan { double operator()(double a) const { return std::tan(a); } };
+struct Nand { bool operator()(bool a, bool b) const { return !(a && b); } };
+struct Nor { bool operator()(bool a, bool b) const { return !(a || b); } };
+struct InvertFirstThenAnd { bool operator()(bool a, bool b) const { return a && !b; } };
+struct InvertSecondThenAnd { bool operator()(bool a, bool b) const { return !a && b; } };
+
+void literal(Machine& machine, const Closure& closure) {
+	machine.number_stack.push_back(closure.value);
+}
+
+void input(Machine& machine, const Closure& closure) {
+	if (closure.arg < machine.num_inputs) {
+		machine.number_stack.push_back(machine.inputs[closure.arg]);
+	}
+}
+
+void bool_input(Machine& machine, const Closure& closure) {
+	if (closure.arg < machine.num_inputs) {
+		machine.bool_stack.push_back(machine.inputs[closure.arg] != 0);
+	}
+}
+
+void push_block(Machine& machine, const Closure& closure) {
+	machine.frames.push(closure.begin, closure.end);
+}
+
+// a block that can't redirect the exec stack runs the same as its contents
+void inline_block(Machine& machine, const Closure& closure) {
+	if (!machine.frames.charge(static_cast<std::size_t>(closure.end - closure.begin))) {
+		return;
+	}
+	for (const Closure* item = closure.begin; item != closure.end; ++item) {
+		item->run(machine, *item);
+		// only a nested block can go over the limits
+		if (item->run == inline_block && machine.frames.cut_off()) {
+			return;
+		}
+	}
+}
+
+void exec_dup(Machine& machine, const Closure&) {
+	machine.frames.dup_next();
+}
+
+void exec_if(Machine& machine, const Closure&) {
+	if (machine.frames.has_two_items() && !machine.bool_stack.empty()) {
+		bool condition = machine.bool_stack.back();
+		machine.bool_stack.pop_back();
+		if (condition) {
+			machine.frames.skip_second();
+		} else {
+			machine.frames.pop_next();
+		}
+	}
+}
+
+void exec_pop(Machine& machine, const Closure&) {
+	machine.frames.pop_next();
+}
+
+template <typename F, bool checked = true>
+void binary(Machine& machine, const Closure&) {
+	auto& stack = machine.number_stack;
+	if (!checked || stack.size() >= 2) {
+		double b = stack.back();
+		stack.pop_back();
+		stack.back() = F()(stack.back(), b);
+	}
+}
+
+template <typename F, bool checked = true>
+void unary(Machine& machine, const Closure&) {
+	auto& stack = machine.number_stack;
+	if (!checked || !stack.empty()) {
+		stack.back() = F()(stack.back());
+	}
+}
+
+template <typename F>
+void compare(Machine& machine, const Closure&) {
+	auto& stack = machine.number_stack;
+	if (stack.size() >= 2) {
+		double b = stack.back();
+		stack.pop_back();
+		double a = stack.back();
+		stack.pop_back();
+		machine.bool_stack.push_back(F()(a, b));
+	}
+}
+
+template <typename F>
+void logic(Machine& machine, const Closure&) {
+	auto& stack = machine.bool_stack;
+	if (stack.size() >= 2) {
+		bool b = stack.back();
+		stack.pop_back();
+		stack.back() = F()(stack.back(), b);
+	}
+}
+
+void bool_not(Machine& machine, const Closure&) {
+	auto& stack = machine.bool_stack;
+	if (!stack.empty()) {
+		stack.back() = !stack.back();
+	}
+}
+
+template <typename F>
+void literal_then(Machine& machine, const Closure& closure) {
+	literal(machine, closure);
+	binary<F>(machine, closure);
+}
+
+void literal_mul_add(Machine& machine, const Closure& closure) {
+	literal(machine, closure);
+	binary<std::multiplies<>>(machine, closure);
+	binary<std::plus<>>(machine, closure);
+}
+
+template <typename F>
+void input_then(Machine& machine, const Closure& closure) {
+	input(machine, closure);
+	binary<F>(machine, closure);
+}
+
+void input_mul_add(Machine& machine, const Closure& closure) {
+	input(machine, closure);
+	binary<std::multiplies<>>(machine, closure);
+	binary<std::plus<>>(machine, closure);
+}
+
+using Run = void (*)(Machine&, const Closure&);
+
+Run compile(Opcode opcode) {
+	switch (opcode) {
+	case Opcode::literal: return literal;
+	case Opcode::literal_int: return literal;
+	case Opcode::literal_constant: return literal;
+	case Opcode::block: return push_block;
+	case Opcode::input: return input;
+	case Opcode::bool_input: return bool_input;
+	case Opcode::exec_dup: return exec_dup;
+	case Opcode::exec_if: return exec_if;
+	case Opcode::exec_pop: return exec_pop;
+	case Opcode::number_add: return binary<std::plus<>>;
+	case Opcode::number_sub: return binary<std::minus<>>;
+	case Opcode::number_mul: return binary<std::multiplies<>>;
+	case Opcode::number_div: return binary<std::divides<>>;
+	case Opcode::number_mod: return binary<Fmod>;
+	case Opcode::number_max: return binary<Max>;
+	case Opcode::number_min: return binary<Min>;
+	case Opcode::number_cos: return unary<Cos>;
+	case Opcode::number_sin: return unary<Sin>;
+	case Opcode::number_tan: return unary<Tan>;
+	case Opcode::number_lt: return compare<std::less<>>;
+	case Opcode::number_gt: return compare<std::greater<>>;
+	case Opcode::bool_and: return logic<std::logical_and<>>;
+	case Opcode::bool_or: return logic<std::logical_or<>>;
+	case Opcode::bool_not: return bool_not;
+	case Opcode::bool_nand: return logic<Nand>;
+	case Opcode::bool_nor: return logic<Nor>;
+	case Opcode::bool_xor: return logic<std::not_equal_to<>>;
+	case Opcode::bool_invert_first_then_and: return logic<InvertFirstThenAnd>;
+	case Opcode::bool_invert_second_then_and: return logic<InvertSecondThenAnd>;
+	case Opcode::literal_add: return literal_then<std::plus<>>;
+	case Opcode::literal_sub: return literal_then<std::minus<>>;
+	case Opcode::literal_mul: return literal_then<std::multiplies<>>;
+	case Opcode::literal_div: return literal_then<std::divides<>>;
+	case Opcode::literal_mul_add: return literal_mul_add;
+	case Opcode::input_add: return input_then<std::plus<>>;
+	case Opcode::input_sub: return input_then<std::minus<>>;
+	case Opcode::input_mul: return input_then<std::multiplies<>>;
+	case Opcode::input_div: return input_then<std::divides<>>;
+	case Opcode::input_mul_add: return input_mul_add;
+	case Opcode::number_add_unchecked: return binary<std::plus<>, false>;
+	case Opcode::number_sub_unchecked: return binary<std::minus<>, false>;
+	case Opcode::number_mul_unchecked: return binary<std::multiplies<>, false>;
+	case Opcode::number_div_unchecked: return binary<std::divides<>, false>;
+	case Opcode::number_mod_unchecked: return binary<Fmod, false>;
+	case Opcode::number_max_unchecked: return binary<Max, false>;
+	case Opcode::number_min_unchecked: return binary<Min, false>;
+	case Opcode::number_cos_unchecked: return unary<Cos, false>;
+	case Opcode::number_sin_unchecked: return unary<Sin, false>;
+	case Opcode::number_tan_unchecked: return unary<Tan, false>;
+	case Opcode::count: break;
+	}
+	return nullptr;
+}
+
+} // namespace
+
+ClosureProgram::ClosureProgram(const Program& program) : closures(program.code.size() + 1) {
+	auto redirecting = redirecting_blocks(program);
+	auto bind_block = [&](Closure& closure, std::size_t index) {
+		closure.run = redirecting[index] ? push_block : inline_block;
+		closure.begin = closures.data() + program.blocks[index].begin;
+		closure.end = closures.data() + program.blocks[index].end;
+	};
+
+	for (std::size_t i = 0; i < program.code.size(); ++i) {
+		Bytecode insn = program.code[i];
+		Closure& closure = closures[i];
+		closure.run = compile(insn.opcode);
+		if (insn.opcode == Opcode::literal || (insn.opcode >= Opcode::literal_add && insn.opcode <= Opcode::literal_mul_add)) {
+			closure.value = program.number_pool[insn.arg];
+		} else if (insn.opcode == Opcode::literal_int || insn.opcode == Opcode::literal_constant) {
+			closure.value = immediate_value(insn);
+		} else if (insn.opcode == Opcode::block) {
+			bind_block(closure, insn.arg);
+		} else {
+			closure.arg = insn.arg;
+		}
+	}
+
+	if (!program.blocks.empty()) {
+		bind_block(closures.back(), 0);
+	} else {
+		closures.back().run = inline_block; // runs nothing
+	}
+}
+
+ClosureProgram::~ClosureProgram() = default;
+ClosureProgram::ClosureProgram(ClosureProgram&& other) noexcept = default;
+ClosureProgram& ClosureProgram::operator=(ClosureProgram&& other) noexcept = default;
+
+void ClosureProgram::run(State& state, const std::vector<double>& inputs) const {
+	Machine machine{state.get_stack<double>(), state.get_stack<bool>(), inputs.data(), inputs.size(), state.closure_frames};
+	state.start_clock();
+	machine.frames.clear();
+	state.frames.clear();
+	const Closure& main = closures.back();
+	main.run(machine, main);
+	while (!machine.frames.empty()) {
+		const Closure& closure = machine.frames.next();
+		closure.run(machine, closure);
+	}
+}
+
+} // namespace cppush
@@ -17,7 +17,7 @@ CodeList::CodeList(std::vector<std::shared_ptr<Code>> code) : vec(code) {}
 
 unsigned CodeList::operator()(State& state) {
 	auto& exec_stack = state.get_stack<Exec>();
-	std::copy(vec.rbegin(), vec.rend(), exec_stack.end());
+	exec_stack.insert(exec_stack.end(), vec.rbegin(), vec.rend());
 
 	return vec.size();
 }
@@ -0,0 +1,173 @@
+#include "cppush/fusion.hpp"
+
+#include "cppush/analysis.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace cppush {
+
+namespace {
+
+// Bytecode::arg is a byte, so that's how many constants the pool can hold
+constexpr std::size_t max_pool = std::numeric_limits<std::uint8_t>::max() + 1;
+
+// immediate literals fuse as pool literals, so patterns only mention literal
+Opcode pattern_opcode(Opcode opcode) {
+	return opcode == Opcode::literal_int || opcode == Opcode::literal_constant ? Opcode::literal : opcode;
+}
+
+bool matches(const std::vector<Bytecode>& code, std::size_t pos, std::size_t end, const std::vector<Opcode>& pattern) {
+	if (end - pos < pattern.size()) {
+		return false;
+	}
+	for (std::size_t i = 0; i < pattern.size(); ++i) {
+		if (pattern_opcode(code[pos + i].opcode) != pattern[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// the arg a superinstruction takes from the leading insn of its sequence.
+// an immediate literal's value moves into the pool, reusing an identical
+// entry. false if the pool is full
+bool fused_arg(Program& program, Bytecode insn, std::uint8_t& arg) {
+	if (pattern_opcode(insn.opcode) == insn.opcode) {
+		arg = insn.arg;
+		return true;
+	}
+	double value = immediate_value(insn);
+	auto& pool = program.number_pool;
+	for (std::size_t i = 0; i < pool.size(); ++i) {
+		if (std::memcmp(&pool[i], &value, sizeof(double)) == 0) {
+			arg = static_cast<std::uint8_t>(i);
+			return true;
+		}
+	}
+	if (pool.size() == max_pool) {
+		return false;
+	}
+	pool.push_back(value);
+	arg = static_cast<std::uint8_t>(pool.size() - 1);
+	return true;
+}
+
+} // namespace
+
+const std::vector<Superinstruction>& superinstructions() {
+	static const std::vector<Superinstruction> all{
+		{Opcode::literal_add, {Opcode::literal, Opcode::number_add}},
+		{Opcode::literal_sub, {Opcode::literal, Opcode::number_sub}},
+		{Opcode::literal_mul, {Opcode::literal, Opcode::number_mul}},
+		{Opcode::literal_div, {Opcode::literal, Opcode::number_div}},
+		{Opcode::literal_mul_add, {Opcode::literal, Opcode::number_mul, Opcode::number_add}},
+		{Opcode::input_add, {Opcode::input, Opcode::number_add}},
+		{Opcode::input_sub, {Opcode::input, Opcode::number_sub}},
+		{Opcode::input_mul, {Opcode::input, Opcode::number_mul}},
+		{Opcode::input_div, {Opcode::input, Opcode::number_div}},
+		{Opcode::input_mul_add, {Opcode::input, Opcode::number_mul, Opcode::number_add}},
+	};
+	return all;
+}
+
+void NgramProfile::add(const Program& program) {
+	for (Block block : program.blocks) {
+		for (std::size_t i = block.begin; i < block.end; ++i) {
+			std::vector<Opcode> ngram{pattern_opcode(program.code[i].opcode)};
+			for (std::size_t j = i + 1; j < block.end && j < i + 3; ++j) {
+				ngram.push_back(pattern_opcode(program.code[j].opcode));
+				++counts[ngram];
+			}
+		}
+	}
+}
+
+std::size_t NgramProfile::count(const std::vector<Opcode>& ngram) const {
+	auto it = counts.find(ngram);
+	return it == counts.end() ? 0 : it->second;
+}
+
+std::vector<Opcode> select_superinstructions(const NgramProfile& profile, std::size_t max) {
+	std::vector<std::pair<std::size_t, Opcode>> seen;
+	for (const auto& insn : superinstructions()) {
+		if (std::size_t count = profile.count(insn.pattern)) {
+			seen.emplace_back(count, insn.opcode);
+		}
+	}
+	std::stable_sort(seen.begin(), seen.end(), [](const auto& a, const auto& b) {
+		return a.first > b.first;
+	});
+
+	std::vector<Opcode> selected;
+	for (std::size_t i = 0; i < seen.size() && i < max; ++i) {
+		selected.push_back(seen[i].second);
+	}
+	return selected;
+}
+
+void fuse(Program& program) {
+	std::vector<Opcode> enabled;
+	for (const auto& insn : superinstructions()) {
+		enabled.push_back(insn.opcode);
+	}
+	fuse(program, enabled);
+}
+
+void fuse(Program& program, const std::vector<Opcode>& enabled) {
+	std::vector<const Superinstruction*> candidates;
+	for (const auto& insn : superinstructions()) {
+		if (std::find(enabled.begin(), enabled.end(), insn.opcode) != enabled.end()) {
+			candidates.push_back(&insn);
+		}
+	}
+	std::stable_sort(candidates.begin(), candidates.end(), [](const auto* a, const auto* b) {
+		return a->pattern.size() > b->pattern.size();
+	});
+
+	// rewrite block by block since fused blocks shrink
+	auto redirecting = redirecting_blocks(program);
+	std::vector<Bytecode> code;
+	code.reserve(program.code.size());
+	for (Block& block : program.blocks) {
+		auto begin = static_cast<std::uint32_t>(code.size());
+		// an exec instruction may skip or repeat any of the items after it, and
+		// those must stay separate
+		bool fusable = true;
+		std::size_t pos = block.begin;
+		while (pos < block.end) {
+			const Superinstruction* match = nullptr;
+			std::uint8_t arg = 0;
+			for (const auto* candidate : candidates) {
+				if (fusable && matches(program.code, pos, block.end, candidate->pattern)) {
+					if (fused_arg(program, program.code[pos], arg)) {
+						match = candidate;
+					}
+					break;
+				}
+			}
+
+			if (match) {
+				code.push_back({match->opcode, arg});
+				pos += match->pattern.size();
+			} else {
+				Bytecode insn = program.code[pos++];
+				code.push_back(insn);
+				if (is_exec_instruction(insn.opcode) || (insn.opcode == Opcode::block && redirecting[insn.arg])) {
+					fusable = false;
+				}
+			}
+		}
+		block = {begin, static_cast<std::uint32_t>(code.size())};
+	}
+	program.code = std::move(code);
+}
+
+} // namespace cppush
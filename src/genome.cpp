@@ -0,0 +1,149 @@
+#include "cppush/genome.hpp"
+
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+#include "cppush/registry.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace cppush {
+
+namespace {
+
+// Bytecode::arg is a byte, so that's how many blocks and constants we can address
+constexpr std::size_t max_arg = std::numeric_limits<std::uint8_t>::max() + 1;
+
+// a block that hasn't been closed yet
+struct OpenBlock {
+	std::size_t index; // into Program::blocks
+	std::size_t start; // offset of the block's contents in the scratch buffer
+	unsigned remaining; // sibling blocks still requested by the opening instruction
+};
+
+class Translator {
+public:
+	Translator(const Genome& genome) {
+		scratch.reserve(genome.size());
+		program.code.reserve(genome.size());
+		open.push_back({new_block(), 0, 0}); // main program
+	}
+
+	void instruction(Bytecode insn) {
+		scratch.push_back(insn);
+		if (unsigned parens = parens_required(insn.opcode)) {
+			open_block(parens - 1);
+		}
+	}
+
+	void literal(double value) {
+		// small integers and common constants fit in the instruction itself
+		if (value >= -128 && value <= 127 && std::trunc(value) == value && !(value == 0 && std::signbit(value))) {
+			scratch.push_back({Opcode::literal_int, static_cast<std::uint8_t>(static_cast<std::int8_t>(value))});
+			return;
+		}
+		for (std::size_t i = 0; i < std::size(common_constants); ++i) {
+			if (std::memcmp(&common_constants[i], &value, sizeof(double)) == 0) {
+				scratch.push_back({Opcode::literal_constant, static_cast<std::uint8_t>(i)});
+				return;
+			}
+		}
+		scratch.push_back({Opcode::literal, constant(value)});
+	}
+
+	void close() {
+		if (open.size() == 1) {
+			return; // nothing to close but the main program
+		}
+		unsigned remaining = open.back().remaining;
+		close_block();
+		if (remaining) {
+			open_block(remaining - 1);
+		}
+	}
+
+	Program finish() {
+		while (!open.empty()) {
+			close_block();
+		}
+		return std::move(program);
+	}
+
+private:
+	std::uint8_t new_block() {
+		if (program.blocks.size() == max_arg) {
+			throw std::length_error("genome_to_program(): too many blocks");
+		}
+		program.blocks.push_back({});
+		return program.blocks.size() - 1;
+	}
+
+	// reference the new block from its parent and collect its contents above the parent's
+	void open_block(unsigned remaining) {
+		std::uint8_t index = new_block();
+		scratch.push_back({Opcode::block, index});
+		open.push_back({index, scratch.size(), remaining});
+	}
+
+	// move the innermost block from the scratch buffer to its final place in the program
+	void close_block() {
+		const OpenBlock& block = open.back();
+		auto begin = static_cast<std::uint32_t>(program.code.size());
+		program.code.insert(program.code.end(), scratch.begin() + block.start, scratch.end());
+		program.blocks[block.index] = {begin, static_cast<std::uint32_t>(program.code.size())};
+		scratch.resize(block.start);
+		open.pop_back();
+	}
+
+	std::uint8_t constant(double value) {
+		// compare bit patterns so 0.0 and -0.0 stay distinct
+		auto& pool = program.number_pool;
+		for (std::size_t i = 0; i < pool.size(); ++i) {
+			if (std::memcmp(&pool[i], &value, sizeof(double)) == 0) {
+				return i;
+			}
+		}
+		if (pool.size() == max_arg) {
+			throw std::length_error("genome_to_program(): too many constants");
+		}
+		pool.push_back(value);
+		return pool.size() - 1;
+	}
+
+	Program program;
+	std::vector<Bytecode> scratch; // contents of every open block, innermost last
+	std::vector<OpenBlock> open;
+};
+
+} // namespace
+
+unsigned parens_required(Opcode opcode) {
+	return instruction_info(opcode).parens;
+}
+
+Program genome_to_program(const Genome& genome) {
+	Translator translator(genome);
+	for (const Gene& gene : genome) {
+		switch (gene.type) {
+		case Gene::Type::Instruction:
+			translator.instruction(gene.instruction);
+			break;
+		case Gene::Type::Literal:
+			translator.literal(gene.literal);
+			break;
+		case Gene::Type::Close:
+			translator.close();
+			break;
+		}
+	}
+	return translator.finish();
+}
+
+} // namespace cppush
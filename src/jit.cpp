@@ -0,0 +1,340 @@
+#include "cppush/jit.hpp"
+
+#include "cppush/analysis.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define CPPUSH_JIT 1
+#include <sys/mman.h>
+#endif
+
+namespace cppush {
+
+namespace {
+
+// called from compiled code, so they compute exactly what the number ops do
+double call_fmod(double a, double b) { return std::fmod(a, b); }
+double call_cos(double a) { return std::cos(a); }
+double call_sin(double a) { return std::sin(a); }
+double call_tan(double a) { return std::tan(a); }
+
+// sse2 scalar double ops taking xmm0 as destination
+enum class SseOp : std::uint8_t {
+	add = 0x58,
+	mul = 0x59,
+	sub = 0x5c,
+	min = 0x5d,
+	div = 0x5e,
+	max = 0x5f,
+};
+
+// Emits code for a program with the signature double(const double* inputs).
+// The inputs pointer lives in rbx. Stack item k lives at [rsp + 8k], except
+// the top item which is kept in xmm0
+class Compiler {
+public:
+	Compiler(const Program& program, std::size_t inputs) : program(program), inputs(inputs) {}
+
+	std::vector<std::uint8_t> compile() {
+		emit({0x53}); // push rbx
+		emit({0x48, 0x89, 0xfb}); // mov rbx, rdi
+		emit({0x48, 0x81, 0xec}); // sub rsp, frame
+		std::size_t frame_at = code.size();
+		imm32(0);
+
+		block(0);
+
+		if (depth == 0) {
+			load_constant(std::numeric_limits<double>::quiet_NaN());
+		}
+		// the return address and rbx leave rsp 16 byte aligned, as calls require
+		std::uint32_t frame = (max_depth * 8 + 15) / 16 * 16;
+		emit({0x48, 0x81, 0xc4}); // add rsp, frame
+		imm32(frame);
+		emit({0x5b}); // pop rbx
+		emit({0xc3}); // ret
+		std::memcpy(&code[frame_at], &frame, sizeof(frame));
+		return std::move(code);
+	}
+
+private:
+	void block(std::size_t index) {
+		Block block = program.blocks[index];
+		for (std::uint32_t i = block.begin; i < block.end; ++i) {
+			Bytecode insn = program.code[i];
+			switch (insn.opcode) {
+			case Opcode::literal:
+				push_constant(program.number_pool[insn.arg]);
+				break;
+			case Opcode::literal_int:
+			case Opcode::literal_constant:
+				push_constant(immediate_value(insn));
+				break;
+			case Opcode::block:
+				this->block(insn.arg);
+				break;
+			case Opcode::input:
+				push_input(insn.arg);
+				break;
+			case Opcode::number_add:
+			case Opcode::number_add_unchecked:
+				arithmetic(SseOp::add);
+				break;
+			case Opcode::number_sub:
+			case Opcode::number_sub_unchecked:
+				arithmetic(SseOp::sub);
+				break;
+			case Opcode::number_mul:
+			case Opcode::number_mul_unchecked:
+				arithmetic(SseOp::mul);
+				break;
+			case Opcode::number_div:
+			case Opcode::number_div_unchecked:
+				arithmetic(SseOp::div);
+				break;
+			case Opcode::number_mod:
+			case Opcode::number_mod_unchecked:
+				if (depth >= 2) {
+					operands();
+					call(reinterpret_cast<std::uint64_t>(&call_fmod));
+					--depth;
+				}
+				break;
+			// maxsd/minsd return their second operand unless the first is strictly
+			// greater/less. with b in xmm0 that is exactly std::max(a, b)/std::min(a, b)
+			case Opcode::number_max:
+			case Opcode::number_max_unchecked:
+				select(SseOp::max);
+				break;
+			case Opcode::number_min:
+			case Opcode::number_min_unchecked:
+				select(SseOp::min);
+				break;
+			case Opcode::number_cos:
+			case Opcode::number_cos_unchecked:
+				unary(reinterpret_cast<std::uint64_t>(&call_cos));
+				break;
+			case Opcode::number_sin:
+			case Opcode::number_sin_unchecked:
+				unary(reinterpret_cast<std::uint64_t>(&call_sin));
+				break;
+			case Opcode::number_tan:
+			case Opcode::number_tan_unchecked:
+				unary(reinterpret_cast<std::uint64_t>(&call_tan));
+				break;
+			// the bools they push can't be observed without exec_if
+			case Opcode::number_lt:
+			case Opcode::number_gt:
+				if (depth >= 2) {
+					depth -= 2;
+					if (depth > 0) {
+						slot_op(0x10, 0, depth - 1); // movsd xmm0, [slot]
+					}
+				}
+				break;
+			case Opcode::literal_add:
+				push_constant(program.number_pool[insn.arg]);
+				arithmetic(SseOp::add);
+				break;
+			case Opcode::literal_sub:
+				push_constant(program.number_pool[insn.arg]);
+				arithmetic(SseOp::sub);
+				break;
+			case Opcode::literal_mul:
+				push_constant(program.number_pool[insn.arg]);
+				arithmetic(SseOp::mul);
+				break;
+			case Opcode::literal_div:
+				push_constant(program.number_pool[insn.arg]);
+				arithmetic(SseOp::div);
+				break;
+			case Opcode::literal_mul_add:
+				push_constant(program.number_pool[insn.arg]);
+				arithmetic(SseOp::mul);
+				arithmetic(SseOp::add);
+				break;
+			case Opcode::input_add:
+				push_input(insn.arg);
+				arithmetic(SseOp::add);
+				break;
+			case Opcode::input_sub:
+				push_input(insn.arg);
+				arithmetic(SseOp::sub);
+				break;
+			case Opcode::input_mul:
+				push_input(insn.arg);
+				arithmetic(SseOp::mul);
+				break;
+			case Opcode::input_div:
+				push_input(insn.arg);
+				arithmetic(SseOp::div);
+				break;
+			case Opcode::input_mul_add:
+				push_input(insn.arg);
+				arithmetic(SseOp::mul);
+				arithmetic(SseOp::add);
+				break;
+			default:
+				break; // rejected by is_straight_line()
+			}
+		}
+	}
+
+	// store the cached top to its slot so a new item can take its place
+	void spill() {
+		if (depth > 0) {
+			slot_op(0x11, 0, depth - 1); // movsd [slot], xmm0
+		}
+		++depth;
+		max_depth = std::max(max_depth, depth);
+	}
+
+	void push_constant(double value) {
+		spill();
+		load_constant(value);
+	}
+
+	void push_input(std::size_t n) {
+		if (n < inputs) {
+			spill();
+			emit({0xf2, 0x0f, 0x10, 0x83}); // movsd xmm0, [rbx + disp32]
+			imm32(std::uint32_t(n * 8));
+		}
+	}
+
+	// a in xmm0, b in xmm1
+	void operands() {
+		emit({0x66, 0x0f, 0x28, 0xc8}); // movapd xmm1, xmm0
+		slot_op(0x10, 0, depth - 2); // movsd xmm0, [slot]
+	}
+
+	void arithmetic(SseOp op) {
+		if (depth >= 2) {
+			operands();
+			emit({0xf2, 0x0f, std::uint8_t(op), 0xc1}); // op xmm0, xmm1
+			--depth;
+		}
+	}
+
+	void select(SseOp op) {
+		if (depth >= 2) {
+			slot_op(std::uint8_t(op), 0, depth - 2); // op xmm0, [slot]
+			--depth;
+		}
+	}
+
+	void unary(std::uint64_t function) {
+		if (depth >= 1) {
+			call(function);
+		}
+	}
+
+	void call(std::uint64_t function) {
+		emit({0x48, 0xb8}); // mov rax, imm64
+		imm64(function);
+		emit({0xff, 0xd0}); // call rax
+	}
+
+	void load_constant(double value) {
+		std::uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		emit({0x48, 0xb8}); // mov rax, imm64
+		imm64(bits);
+		emit({0x66, 0x48, 0x0f, 0x6e, 0xc0}); // movq xmm0, rax
+	}
+
+	// sse2 scalar double op between xmm<reg> and the stack slot [rsp + disp32]
+	void slot_op(std::uint8_t op, std::uint8_t reg, std::size_t slot) {
+		emit({0xf2, 0x0f, op, std::uint8_t(0x84 | reg << 3), 0x24});
+		imm32(std::uint32_t(slot * 8));
+	}
+
+	void emit(std::initializer_list<std::uint8_t> bytes) {
+		code.insert(code.end(), bytes);
+	}
+
+	void imm32(std::uint32_t value) {
+		for (int i = 0; i < 4; ++i) {
+			code.push_back(std::uint8_t(value >> (8 * i)));
+		}
+	}
+
+	void imm64(std::uint64_t value) {
+		for (int i = 0; i < 8; ++i) {
+			code.push_back(std::uint8_t(value >> (8 * i)));
+		}
+	}
+
+	const Program& program;
+	std::size_t inputs;
+	std::vector<std::uint8_t> code;
+	std::size_t depth = 0;
+	std::size_t max_depth = 0;
+};
+
+} // namespace
+
+bool NativeProgram::supports(const Program& program) {
+#ifdef CPPUSH_JIT
+	return is_straight_line(program);
+#else
+	(void)program;
+	return false;
+#endif
+}
+
+NativeProgram::NativeProgram(const Program& program, std::size_t inputs) {
+	if (!supports(program)) {
+		throw std::invalid_argument("NativeProgram() program can't be compiled");
+	}
+#ifdef CPPUSH_JIT
+	std::vector<std::uint8_t> code = Compiler(program, inputs).compile();
+	size = code.size();
+	memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		memory = nullptr;
+		throw std::system_error(errno, std::generic_category(), "NativeProgram() mmap");
+	}
+	std::memcpy(memory, code.data(), size);
+	if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+		int error = errno;
+		munmap(memory, size);
+		memory = nullptr;
+		throw std::system_error(error, std::generic_category(), "NativeProgram() mprotect");
+	}
+	entry = reinterpret_cast<Function>(memory);
+#else
+	(void)inputs;
+#endif
+}
+
+NativeProgram::~NativeProgram() {
+#ifdef CPPUSH_JIT
+	if (memory) {
+		munmap(memory, size);
+	}
+#endif
+}
+
+NativeProgram::NativeProgram(NativeProgram&& other) noexcept
+	: memory(std::exchange(other.memory, nullptr)), size(std::exchange(other.size, 0)), entry(std::exchange(other.entry, nullptr)) {}
+
+NativeProgram& NativeProgram::operator=(NativeProgram&& other) noexcept {
+	std::swap(memory, other.memory);
+	std::swap(size, other.size);
+	std::swap(entry, other.entry);
+	return *this;
+}
+
+} // namespace cppush
@@ -0,0 +1,72 @@
+#include "cppush/opcode.hpp"
+#include "cppush/registry.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+namespace cppush {
+
+namespace {
+
+// fnv-1a, then a murmur3 finalizer so the low bits depend on every character
+constexpr std::uint32_t hash(std::string_view name, std::uint32_t seed) {
+	std::uint32_t h = 2166136261u ^ seed;
+	for (char c : name) {
+		h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+// Perfect hash of the opcode names: a seed under which no two names share a
+// slot, so a lookup is one hash and one string compare. Found at compile time
+struct NameTable {
+	static constexpr std::size_t size = 1024; // sparse enough that a seed turns up quickly
+	std::uint32_t seed = 0;
+	std::array<std::uint8_t, size> slots{}; // opcode + 1, or 0 for no name
+};
+
+constexpr NameTable build_name_table() {
+	for (std::uint32_t seed = 0;; ++seed) {
+		NameTable table;
+		table.seed = seed;
+		bool collided = false;
+		for (std::size_t i = 0; i < opcode_count && !collided; ++i) {
+			auto& slot = table.slots[hash(instructions[i].name, seed) % NameTable::size];
+			collided = slot != 0;
+			slot = static_cast<std::uint8_t>(i + 1);
+		}
+		if (!collided) {
+			return table;
+		}
+	}
+}
+
+constexpr NameTable name_table = build_name_table();
+
+} // namespace
+
+std::string_view opcode_name(Opcode opcode) {
+	if (opcode >= Opcode::count) {
+		throw std::invalid_argument("opcode_name(): not an opcode");
+	}
+	return instruction_info(opcode).name;
+}
+
+std::optional<Opcode> find_opcode(std::string_view name) {
+	std::uint8_t slot = name_table.slots[hash(name, name_table.seed) % NameTable::size];
+	if (slot == 0 || instructions[slot - 1].name != name) {
+		return std::nullopt;
+	}
+	return static_cast<Opcode>(slot - 1);
+}
+
+} // namespace cppush
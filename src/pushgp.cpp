@@ -1 +1,357 @@
-#include "pushgp.h"
\ No newline at end of file
+#include "cppush/pushgp.hpp"
+
+#include "cppush/genome.hpp"
+#include "cppush/program.hpp"
+#include "cppush/state.hpp"
+#include "cppush/thread_pool.hpp"
+#include "cppush/tiering.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace cppush {
+
+namespace {
+
+// whether error_a, of individual a, ranks before error_b, of individual b.
+// NaN errors rank last and ties go to the earlier individual, so rankings
+// don't depend on which worker evaluated which individuals
+bool ranks_before(double error_a, std::size_t a, double error_b, std::size_t b) {
+	if (std::isnan(error_a) || std::isnan(error_b)) {
+		return std::isnan(error_a) == std::isnan(error_b) ? a < b : std::isnan(error_b);
+	}
+	return error_a < error_b || (error_a == error_b && a < b);
+}
+
+} // namespace
+
+PushGP::PushGP(PushGPConfig config) : config(std::move(config)), rng(std::random_device()()) {
+	init();
+}
+
+PushGP::PushGP(PushGPConfig config, unsigned seed) : config(std::move(config)), rng(seed) {
+	init();
+}
+
+const Program& PushGP::get_best() const {
+	if (!best_individual) {
+		throw std::logic_error("PushGP::get_best(): no individuals have been evaluated");
+	}
+	return best_individual->get_program();
+}
+
+void PushGP::init() {
+	// validate config
+	if (config.population_size < 1) {
+		throw std::range_error("PushGPConfig: population_size must be > 0");
+	} else if (config.max_generations < 1) {
+		throw std::range_error("PushGPConfig: max_generations must be > 0");
+	} else if (config.initial_genome_size < 1) {
+		throw std::range_error("PushGPConfig: initial_genome_size must be > 0");
+	} else if (config.elite_count < 0 || config.elite_count > config.population_size) {
+		throw std::range_error("PushGPConfig: elite_count must be in [0, population_size]");
+	} else if (config.tournament_size < 1) {
+		throw std::range_error("PushGPConfig: tournament_size must be > 0");
+	}
+
+	pool = std::make_unique<ThreadPool>(config.threads);
+	states.resize(pool->size());
+	for (auto& state : states) {
+		state.set_effort_limit(config.effort_limit);
+		state.set_time_limit(config.time_limit);
+	}
+
+	generation = 0;
+	best_score = std::numeric_limits<double>::max();
+
+	// initialize population
+	for (int i = 0; i < config.population_size; ++i) {
+		population.push_back(make_individual(random_genome(config.initial_genome_size)));
+	}
+}
+
+void PushGP::train(int gens) {
+	if (num_fitness_cases() == 0) {
+		throw std::length_error("PushGP::train(): no fitness cases were loaded");
+	}
+
+	evaluate_population();
+	for (int gen = 0; gen < gens; ++gen) {
+		next_generation();
+		evaluate_population();
+		++generation;
+	}
+
+	// the best individual is what gets run from here on
+	promote(*best_individual);
+}
+
+void PushGP::evaluate_population() {
+	using Clock = std::chrono::steady_clock;
+
+	// compile first, as promotion updates the shared stats
+	const TieringConfig& tiering = config.tiering;
+	if (tiering.enabled) {
+		for (auto& individual : population) {
+			if (individual.age >= tiering.promote_after_generations
+					|| individual.program->get_runs() >= tiering.promote_after_runs) {
+				promote(*individual.program);
+			}
+		}
+	}
+
+	// what each worker saw, combined once they're all done
+	constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+	struct WorkerResult {
+		TierStats stats;
+		std::size_t best = none; // index into population
+	};
+	std::vector<WorkerResult> results(pool->size());
+
+	auto better = [&](std::size_t a, std::size_t b) {
+		return b == none || ranks_before(population[a].error, a, population[b].error, b);
+	};
+
+	// the individuals x cases matrix is split into tiles of a group of programs
+	// by a range of cases. consecutive tiles share cases, so a worker running
+	// through its share keeps the same cases in cache for many programs
+	const std::size_t cases = num_fitness_cases();
+	const std::size_t tile_cases = std::max<std::size_t>(1, config.cache_bytes / 2 / std::max<std::size_t>(1, case_bytes()));
+	const std::size_t case_tiles = (cases + tile_cases - 1) / tile_cases;
+	const auto groups = group_programs();
+	const std::size_t num_groups = groups.size() - 1;
+	tile_errors.assign(population.size() * case_tiles, 0);
+	std::vector<std::atomic<bool>> timed_out(population.size());
+	std::vector<std::atomic<std::size_t>> effort(population.size());
+
+	pool->run(case_tiles * num_groups, [&](std::size_t tile, unsigned worker) {
+		State& state = states[worker];
+		WorkerResult& result = results[worker];
+		std::size_t case_tile = tile / num_groups;
+		std::size_t first_case = case_tile * tile_cases;
+		std::size_t last_case = std::min(cases, first_case + tile_cases);
+		std::size_t group = tile % num_groups;
+
+		for (std::size_t index = groups[group]; index < groups[group + 1]; ++index) {
+			if (timed_out[index]) {
+				continue;
+			}
+			TieredProgram& program = *population[index].program;
+			auto tier = program.get_tier();
+			auto start = Clock::now();
+			std::size_t runs = 0;
+			std::size_t tile_effort = 0;
+			double error = 0;
+			for (std::size_t fitness_case = first_case; fitness_case < last_case; ++fitness_case) {
+				error += evaluate(program, state, fitness_case);
+				++runs;
+				// native code doesn't charge effort, but runs each instruction once
+				tile_effort += tier == Tier::native ? program.get_program().code.size() : state.get_effort();
+				if (state.timed_out()) {
+					timed_out[index] = true;
+					break;
+				}
+			}
+			tile_errors[index * case_tiles + case_tile] = error;
+			effort[index].fetch_add(tile_effort, std::memory_order_relaxed);
+			result.stats.time[std::size_t(tier)] += Clock::now() - start;
+			result.stats.runs[std::size_t(tier)] += runs;
+		}
+	});
+
+	pool->run(population.size(), [&](std::size_t index, unsigned worker) {
+		double total_error = 0;
+		for (std::size_t case_tile = 0; case_tile < case_tiles; ++case_tile) {
+			total_error += tile_errors[index * case_tiles + case_tile];
+		}
+		population[index].error = timed_out[index] ? config.timeout_penalty : total_error;
+		population[index].effort = effort[index];
+		if (better(index, results[worker].best)) {
+			results[worker].best = index;
+		}
+	});
+
+	std::size_t best = none;
+	for (const auto& result : results) {
+		for (std::size_t tier = 0; tier < tier_count; ++tier) {
+			tier_stats.time[tier] += result.stats.time[tier];
+			tier_stats.runs[tier] += result.stats.runs[tier];
+		}
+		if (result.best != none && better(result.best, best)) {
+			best = result.best;
+		}
+	}
+
+	// save best. the first evaluation always sets one, even if every error is
+	// inf or NaN, so there is a program to promote and predict with
+	double error = population[best].error;
+	if (!best_individual || error < best_score || (std::isnan(best_score) && !std::isnan(error))) {
+		best_score = error;
+		best_individual = population[best].program;
+	}
+}
+
+void PushGP::next_generation() {
+	std::vector<Individual> next;
+	next.reserve(population.size());
+
+	// elites survive as they are, compiled code and all. they're ranked like
+	// the best individual, so NaN errors go last
+	std::vector<std::size_t> order(population.size());
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::partial_sort(order.begin(), order.begin() + config.elite_count, order.end(), [&](std::size_t a, std::size_t b) {
+		return ranks_before(population[a].error, a, population[b].error, b);
+	});
+	for (int i = 0; i < config.elite_count; ++i) {
+		next.push_back(population[order[i]]);
+		++next.back().age;
+	}
+
+	while (next.size() < population.size()) {
+		next.push_back(make_individual(mutate(tournament().genome)));
+	}
+	population = std::move(next);
+}
+
+void PushGP::promote(TieredProgram& program) {
+	if (program.get_tier() != Tier::interpreter) {
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+	program.promote(num_inputs());
+	tier_stats.compile_time += std::chrono::steady_clock::now() - start;
+	++tier_stats.promotions;
+}
+
+PushGP::Individual PushGP::make_individual(Genome genome) const {
+	Program program;
+	try {
+		program = genome_to_program(genome);
+	} catch (const std::length_error&) {
+		// too many blocks or constants to address. runs as an empty program
+	}
+	return {std::move(genome), std::make_shared<TieredProgram>(std::move(program))};
+}
+
+// boundaries of groups of consecutive individuals, splitting the population
+// into groups of similar cost so the pool can balance skewed run times. cost
+// is the effort an individual took last time it was evaluated, or for new
+// offspring, its length on every case. an expensive program gets a group of
+// its own
+std::vector<std::size_t> PushGP::group_programs() const {
+	auto cost = [&](const Individual& individual) {
+		if (individual.effort > 0) {
+			return individual.effort;
+		}
+		return (individual.program->get_program().code.size() + 1) * num_fitness_cases();
+	};
+	std::size_t total_cost = 0;
+	for (const auto& individual : population) {
+		total_cost += cost(individual);
+	}
+	// enough groups for every worker to steal from several
+	std::size_t target = std::max<std::size_t>(1, total_cost / (pool->size() * 8));
+
+	std::vector<std::size_t> groups{0};
+	std::size_t group_cost = 0;
+	for (std::size_t index = 0; index < population.size(); ++index) {
+		group_cost += cost(population[index]);
+		if (group_cost >= target) {
+			groups.push_back(index + 1);
+			group_cost = 0;
+		}
+	}
+	if (groups.back() != population.size()) {
+		groups.push_back(population.size());
+	}
+	return groups;
+}
+
+const PushGP::Individual& PushGP::tournament() {
+	std::uniform_int_distribution<std::size_t> pick(0, population.size() - 1);
+	const Individual* winner = &population[pick(rng)];
+	for (int i = 1; i < config.tournament_size; ++i) {
+		const Individual& challenger = population[pick(rng)];
+		if (challenger.error < winner->error) {
+			winner = &challenger;
+		}
+	}
+	return *winner;
+}
+
+// umad: insert a random gene before each gene with probability umad_rate, then
+// delete genes at a rate that keeps the expected size the same
+Genome PushGP::mutate(const Genome& genome) {
+	std::bernoulli_distribution add(config.umad_rate);
+	std::bernoulli_distribution remove(config.umad_rate / (1 + config.umad_rate));
+
+	Genome added;
+	added.reserve(genome.size() * 2);
+	for (const Gene& gene : genome) {
+		if (add(rng)) {
+			added.push_back(random_gene());
+		}
+		added.push_back(gene);
+	}
+	if (add(rng)) {
+		added.push_back(random_gene());
+	}
+
+	Genome child;
+	child.reserve(added.size());
+	for (const Gene& gene : added) {
+		if (!remove(rng)) {
+			child.push_back(gene);
+		}
+	}
+	return child;
+}
+
+Genome PushGP::random_genome(int size) {
+	Genome genome;
+	genome.reserve(size);
+	for (int i = 0; i < size; ++i) {
+		genome.push_back(random_gene());
+	}
+	return genome;
+}
+
+Gene PushGP::random_gene() {
+	double close_weight = 0;
+	for (const auto& insn : config.instruction_set) {
+		close_weight += parens_required(insn.opcode);
+	}
+	std::discrete_distribution<> dist({
+		static_cast<double>(config.instruction_set.size()),
+		static_cast<double>(config.literal_set.size()),
+		static_cast<double>(config.erc_generators.size()),
+		close_weight
+	});
+
+	auto pick = [&](std::size_t size) {
+		return std::uniform_int_distribution<std::size_t>(0, size - 1)(rng);
+	};
+	switch (dist(rng)) {
+	case 0: // instruction
+		return {Gene::Type::Instruction, config.instruction_set[pick(config.instruction_set.size())]};
+	case 1: // literal
+		return {Gene::Type::Literal, {}, config.literal_set[pick(config.literal_set.size())]};
+	case 2: // ERC
+		return {Gene::Type::Literal, {}, config.erc_generators[pick(config.erc_generators.size())](rng)};
+	default: // close
+		return {Gene::Type::Close};
+	}
+}
+
+} // namespace cppush
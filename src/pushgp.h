@@ -1,10 +0,0 @@
-#ifndef PUSHGP_H
-#define PUSHGP_H
-
-namespace cppush {
-
-
-
-} // namespace cppush
-
-#endif // PUSHGP_H
\ No newline at end of file
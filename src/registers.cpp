@@ -0,0 +1,270 @@
+#include "cppush/registers.hpp"
+
+#include "cppush/analysis.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace cppush {
+
+namespace {
+
+using Op = RegisterProgram::Op;
+using Insn = RegisterProgram::Insn;
+
+// Symbolically runs a program, with the stack holding the registers of its
+// items instead of their values
+class Translator {
+public:
+	Translator(const Program& program, std::size_t inputs) : program(program), inputs(inputs) {}
+
+	void block(std::size_t index) {
+		Block block = program.blocks[index];
+		for (std::uint32_t i = block.begin; i < block.end; ++i) {
+			Bytecode insn = program.code[i];
+			switch (insn.opcode) {
+			case Opcode::literal:
+				push_constant(program.number_pool[insn.arg]);
+				break;
+			case Opcode::literal_int:
+			case Opcode::literal_constant:
+				push_constant(immediate_value(insn));
+				break;
+			case Opcode::block:
+				this->block(insn.arg);
+				break;
+			case Opcode::input:
+				push_input(insn.arg);
+				break;
+			case Opcode::number_add:
+			case Opcode::number_add_unchecked:
+				binary(Op::add);
+				break;
+			case Opcode::number_sub:
+			case Opcode::number_sub_unchecked:
+				binary(Op::sub);
+				break;
+			case Opcode::number_mul:
+			case Opcode::number_mul_unchecked:
+				binary(Op::mul);
+				break;
+			case Opcode::number_div:
+			case Opcode::number_div_unchecked:
+				binary(Op::div);
+				break;
+			case Opcode::number_mod:
+			case Opcode::number_mod_unchecked:
+				binary(Op::mod);
+				break;
+			case Opcode::number_max:
+			case Opcode::number_max_unchecked:
+				binary(Op::max);
+				break;
+			case Opcode::number_min:
+			case Opcode::number_min_unchecked:
+				binary(Op::min);
+				break;
+			case Opcode::number_cos:
+			case Opcode::number_cos_unchecked:
+				unary(Op::cos);
+				break;
+			case Opcode::number_sin:
+			case Opcode::number_sin_unchecked:
+				unary(Op::sin);
+				break;
+			case Opcode::number_tan:
+			case Opcode::number_tan_unchecked:
+				unary(Op::tan);
+				break;
+			// only their bools depend on the operands, and those aren't modelled
+			case Opcode::number_lt:
+			case Opcode::number_gt:
+				if (stack.size() >= 2) {
+					stack.resize(stack.size() - 2);
+				}
+				break;
+			case Opcode::literal_add:
+			case Opcode::literal_sub:
+			case Opcode::literal_mul:
+			case Opcode::literal_div:
+				push_constant(program.number_pool[insn.arg]);
+				binary(superinstruction_op(insn.opcode, Opcode::literal_add));
+				break;
+			case Opcode::literal_mul_add:
+				push_constant(program.number_pool[insn.arg]);
+				binary(Op::mul);
+				binary(Op::add);
+				break;
+			case Opcode::input_add:
+			case Opcode::input_sub:
+			case Opcode::input_mul:
+			case Opcode::input_div:
+				push_input(insn.arg);
+				binary(superinstruction_op(insn.opcode, Opcode::input_add));
+				break;
+			case Opcode::input_mul_add:
+				push_input(insn.arg);
+				binary(Op::mul);
+				binary(Op::add);
+				break;
+			default:
+				break; // rejected by is_straight_line()
+			}
+		}
+	}
+
+	// drop instructions whose values never reach the final stack
+	void remove_dead(std::vector<Insn>& out_code, std::vector<std::uint32_t>& out_stack) const {
+		std::vector<bool> live(code.size(), false);
+		for (auto reg : stack) {
+			live[reg] = true;
+		}
+		// operands always come before their users
+		for (std::size_t i = code.size(); i-- > 0;) {
+			if (!live[i]) {
+				continue;
+			}
+			switch (code[i].op) {
+			case Op::constant:
+			case Op::input:
+				break;
+			case Op::cos:
+			case Op::sin:
+			case Op::tan:
+				live[code[i].a] = true;
+				break;
+			default:
+				live[code[i].a] = true;
+				live[code[i].b] = true;
+				break;
+			}
+		}
+
+		std::vector<std::uint32_t> renamed(code.size());
+		for (std::size_t i = 0; i < code.size(); ++i) {
+			if (!live[i]) {
+				continue;
+			}
+			Insn insn = code[i];
+			if (insn.op != Op::constant && insn.op != Op::input) {
+				insn.a = renamed[insn.a];
+				insn.b = renamed[insn.b];
+			}
+			renamed[i] = std::uint32_t(out_code.size());
+			out_code.push_back(insn);
+		}
+		for (auto reg : stack) {
+			out_stack.push_back(renamed[reg]);
+		}
+	}
+
+private:
+	// superinstructions of one family are in the same order as add, sub, mul, div
+	static Op superinstruction_op(Opcode opcode, Opcode first) {
+		return Op(int(Op::add) + int(opcode) - int(first));
+	}
+
+	void push_constant(double value) {
+		std::uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		stack.push_back(emit({Op::constant, 0, 0, value}, bits));
+	}
+
+	void push_input(std::size_t n) {
+		if (n < inputs) {
+			stack.push_back(emit({Op::input, std::uint32_t(n)}));
+		}
+	}
+
+	void binary(Op op) {
+		if (stack.size() >= 2) {
+			std::uint32_t b = stack.back();
+			stack.pop_back();
+			std::uint32_t a = stack.back();
+			// addition and multiplication commute, so a + b and b + a are one value
+			if ((op == Op::add || op == Op::mul) && b < a) {
+				std::swap(a, b);
+			}
+			stack.back() = emit({op, a, b});
+		}
+	}
+
+	void unary(Op op) {
+		if (!stack.empty()) {
+			stack.back() = emit({op, stack.back()});
+		}
+	}
+
+	// register holding insn's value, reusing an identical earlier instruction's
+	std::uint32_t emit(Insn insn, std::uint64_t bits = 0) {
+		auto key = std::make_tuple(insn.op, insn.a, insn.b, bits);
+		auto found = values.find(key);
+		if (found != values.end()) {
+			return found->second;
+		}
+		auto reg = std::uint32_t(code.size());
+		code.push_back(insn);
+		values.emplace(key, reg);
+		return reg;
+	}
+
+	const Program& program;
+	std::size_t inputs;
+	std::vector<Insn> code;
+	std::vector<std::uint32_t> stack;
+	// value numbering: register of each distinct (op, operands, constant bits)
+	std::map<std::tuple<Op, std::uint32_t, std::uint32_t, std::uint64_t>, std::uint32_t> values;
+};
+
+} // namespace
+
+RegisterProgram::RegisterProgram(const Program& program, std::size_t inputs) {
+	if (!is_straight_line(program)) {
+		throw std::invalid_argument("RegisterProgram() program isn't straight-line number code");
+	}
+	Translator translator(program, inputs);
+	translator.block(0);
+	translator.remove_dead(code, stack);
+}
+
+void RegisterProgram::run(const double* inputs, std::vector<double>& registers) const {
+	registers.resize(code.size());
+	double* r = registers.data();
+	for (std::size_t i = 0; i < code.size(); ++i) {
+		const Insn& insn = code[i];
+		switch (insn.op) {
+		case Op::constant: r[i] = insn.value; break;
+		case Op::input: r[i] = inputs[insn.a]; break;
+		case Op::add: r[i] = r[insn.a] + r[insn.b]; break;
+		case Op::sub: r[i] = r[insn.a] - r[insn.b]; break;
+		case Op::mul: r[i] = r[insn.a] * r[insn.b]; break;
+		case Op::div: r[i] = r[insn.a] / r[insn.b]; break;
+		case Op::mod: r[i] = std::fmod(r[insn.a], r[insn.b]); break;
+		case Op::max: r[i] = std::max(r[insn.a], r[insn.b]); break;
+		case Op::min: r[i] = std::min(r[insn.a], r[insn.b]); break;
+		case Op::cos: r[i] = std::cos(r[insn.a]); break;
+		case Op::sin: r[i] = std::sin(r[insn.a]); break;
+		case Op::tan: r[i] = std::tan(r[insn.a]); break;
+		}
+	}
+}
+
+double RegisterProgram::run(const double* inputs) const {
+	if (stack.empty()) {
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+	std::vector<double> registers;
+	run(inputs, registers);
+	return registers[stack.back()];
+}
+
+} // namespace cppush
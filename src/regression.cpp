@@ -0,0 +1,44 @@
+#include "cppush/regression.hpp"
+
+#include "cppush/state.hpp"
+#include "cppush/tiering.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace cppush {
+
+void FloatRegression::fit(std::vector<double> inputs, std::vector<double> outputs, int gens) {
+	if (inputs.size() != outputs.size()) {
+		throw std::invalid_argument("FloatRegression::fit() inputs and outputs must be the same length");
+	}
+
+	this->inputs.clear();
+	for (double input : inputs) {
+		this->inputs.push_back({input});
+	}
+	this->outputs = outputs;
+	train(gens);
+}
+
+double FloatRegression::predict(double input) {
+	get_best(); // throws if not fitted
+	double result = best_individual->run(states[0], {input});
+	return std::isnan(result) ? 0 : result;
+}
+
+std::size_t FloatRegression::num_fitness_cases() const {
+	return inputs.size();
+}
+
+double FloatRegression::evaluate(TieredProgram& program, State& state, std::size_t fitness_case_index) const {
+	double result = program.run(state, inputs[fitness_case_index]);
+	if (std::isnan(result)) {
+		return 1'000; // problem-specific "no output" penalty
+	}
+	return std::abs(result - outputs[fitness_case_index]);
+}
+
+} // namespace cppush
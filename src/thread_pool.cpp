@@ -0,0 +1,140 @@
+#include "cppush/thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace cppush {
+
+namespace {
+
+constexpr std::uint64_t pack(std::uint64_t begin, std::uint64_t end) {
+	return begin << 32 | end;
+}
+constexpr std::uint64_t begin_of(std::uint64_t bounds) { return bounds >> 32; }
+constexpr std::uint64_t end_of(std::uint64_t bounds) { return bounds & 0xffff'ffff; }
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned workers)
+	: num_workers(workers ? workers : std::max(1u, std::thread::hardware_concurrency())),
+	  shares(std::make_unique<Share[]>(num_workers)) {
+	for (unsigned worker = 1; worker < num_workers; ++worker) {
+		threads.emplace_back(&ThreadPool::thread_main, this, worker);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	started.notify_all();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void ThreadPool::run(std::size_t count, const std::function<void(std::size_t, unsigned)>& body) {
+	if (count > std::numeric_limits<std::uint32_t>::max()) {
+		throw std::length_error("ThreadPool::run(): too many indices");
+	}
+
+	for (unsigned worker = 0; worker < num_workers; ++worker) {
+		shares[worker].bounds.store(pack(count * worker / num_workers, count * (worker + 1) / num_workers));
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->body = &body;
+		error = nullptr;
+		running = num_workers - 1;
+		++loop;
+	}
+	started.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&] { return running == 0; });
+	this->body = nullptr;
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void ThreadPool::thread_main(unsigned worker) {
+	std::size_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			started.wait(lock, [&] { return stopping || loop != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = loop;
+		}
+
+		work(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--running;
+		}
+		finished.notify_one();
+	}
+}
+
+void ThreadPool::work(unsigned worker) {
+	std::size_t index;
+	while (claim(worker, index) || steal(worker, index)) {
+		try {
+			(*body)(index, worker);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+	}
+}
+
+// take the first index of the worker's own share
+bool ThreadPool::claim(unsigned worker, std::size_t& index) {
+	auto& bounds = shares[worker].bounds;
+	std::uint64_t current = bounds.load();
+	while (begin_of(current) < end_of(current)) {
+		if (bounds.compare_exchange_weak(current, pack(begin_of(current) + 1, end_of(current)))) {
+			index = begin_of(current);
+			return true;
+		}
+	}
+	return false;
+}
+
+// take the back half of another worker's share, run its first index and keep
+// the rest as this worker's share. only called once the own share is empty,
+// so nobody else can be claiming from it
+bool ThreadPool::steal(unsigned worker, std::size_t& index) {
+	for (unsigned i = 1; i < num_workers; ++i) {
+		auto& bounds = shares[(worker + i) % num_workers].bounds;
+		std::uint64_t current = bounds.load();
+		while (begin_of(current) < end_of(current)) {
+			std::uint64_t mid = begin_of(current) + (end_of(current) - begin_of(current)) / 2;
+			if (bounds.compare_exchange_weak(current, pack(begin_of(current), mid))) {
+				shares[worker].bounds.store(pack(mid + 1, end_of(current)));
+				index = mid;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+} // namespace cppush
@@ -0,0 +1,49 @@
+#include "cppush/tiering.hpp"
+
+#include "cppush/closures.hpp"
+#include "cppush/jit.hpp"
+#include "cppush/program.hpp"
+#include "cppush/state.hpp"
+
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace cppush {
+
+TieredProgram::TieredProgram(Program program) : program(std::move(program)) {}
+
+void TieredProgram::promote(std::size_t inputs) {
+	if (tier != Tier::interpreter) {
+		return;
+	}
+	// closures also cover input counts the native code wasn't compiled for
+	closures = std::make_unique<ClosureProgram>(program);
+	tier = Tier::closures;
+	if (NativeProgram::supports(program)) {
+		native = std::make_unique<NativeProgram>(program, inputs);
+		native_inputs = inputs;
+		tier = Tier::native;
+	}
+}
+
+double TieredProgram::run(State& state, const std::vector<double>& inputs) {
+	runs.fetch_add(1, std::memory_order_relaxed);
+	state.reset();
+	// native code has no effort accounting, but straight-line code charges at
+	// most one per instruction so can only hit a limit below its length
+	if (native && inputs.size() == native_inputs && program.code.size() <= state.get_effort_limit()) {
+		return (*native)(inputs.data());
+	}
+
+	if (closures) {
+		state.run(*closures, inputs);
+	} else {
+		state.run(program, inputs);
+	}
+	const auto& stack = state.get_stack<double>();
+	return stack.empty() ? std::numeric_limits<double>::quiet_NaN() : stack.back();
+}
+
+} // namespace cppush
@@ -0,0 +1,80 @@
+#include "cppush/analysis.hpp"
+#include "cppush/genome.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+#include "cppush/state.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+using cppush::Opcode;
+
+std::vector<double> run(const cppush::Program& program, std::vector<double> inputs) {
+	cppush::State push;
+	push.run(program, inputs);
+	return push.get_stack<double>();
+}
+
+} // namespace
+
+TEST_CASE("min_depths tracks straight-line code") {
+	auto program = cppush::genome_to_program({
+		insn(Opcode::number_add), lit(1), insn(Opcode::input), insn(Opcode::number_add), insn(Opcode::number_sin),
+	});
+
+	REQUIRE(cppush::min_depths(program) == std::vector<std::size_t>{0, 0, 1, 1, 1});
+	REQUIRE(cppush::min_depths(program, 1) == std::vector<std::size_t>{0, 0, 1, 2, 1});
+}
+
+TEST_CASE("elide_checks only removes checks that can't fail") {
+	auto program = cppush::genome_to_program({
+		lit(2), insn(Opcode::number_cos), insn(Opcode::number_mul),
+		insn(Opcode::input), insn(Opcode::number_mul),
+	});
+	auto elided = program;
+	cppush::elide_checks(elided, 1);
+
+	REQUIRE(elided.code[1].opcode == Opcode::number_cos_unchecked);
+	REQUIRE(elided.code[2].opcode == Opcode::number_mul); // only one item on the stack
+	REQUIRE(elided.code[4].opcode == Opcode::number_mul_unchecked);
+	REQUIRE(run(elided, {3}) == run(program, {3}));
+}
+
+TEST_CASE("elide_checks carries depth into blocks but not past exec instructions") {
+	// 1 2 exec_dup (number_add) number_add -- exec_dup runs the block twice
+	auto program = cppush::genome_to_program({
+		lit(1), lit(2), insn(Opcode::exec_dup), insn(Opcode::number_add), close_block(), insn(Opcode::number_add),
+	});
+	auto depths = cppush::min_depths(program);
+	cppush::elide_checks(program);
+
+	for (std::size_t i = 0; i < program.code.size(); ++i) {
+		INFO("instruction " << i << " with min depth " << depths[i]);
+		REQUIRE(program.code[i].opcode != Opcode::number_add_unchecked);
+	}
+	REQUIRE(run(program, {}) == std::vector<double>{3});
+
+	// without exec instructions the block sees the caller's depth
+	cppush::Program nested;
+	nested.code = {{Opcode::literal, 0}, {Opcode::literal, 0}, {Opcode::block, 1}, {Opcode::number_add}};
+	nested.blocks = {{0, 3}, {3, 4}};
+	nested.number_pool = {1};
+	cppush::elide_checks(nested);
+	REQUIRE(nested.code[3].opcode == Opcode::number_add_unchecked);
+	REQUIRE(run(nested, {}) == std::vector<double>{2});
+}
+
+TEST_CASE("min_depths doesn't assume a block skipped by exec_pop ran") {
+	// exec_pop (1) number_add -- the block is popped, so number_add sees an empty stack
+	auto program = cppush::genome_to_program({insn(Opcode::exec_pop), lit(1), close_block(), lit(2), insn(Opcode::number_add)});
+	auto elided = program;
+	cppush::elide_checks(elided);
+
+	REQUIRE(elided.code.back().opcode == Opcode::number_add);
+	REQUIRE(run(elided, {}) == std::vector<double>{2});
+}
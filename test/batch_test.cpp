@@ -0,0 +1,194 @@
+#include "cppush/batch.hpp"
+#include "cppush/fusion.hpp"
+#include "cppush/genome.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/state.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using cppush::Opcode;
+
+TEST_CASE("BatchState runs a program once for several cases") {
+	// x * x + 1
+	auto program = cppush::genome_to_program({
+		insn(Opcode::input), insn(Opcode::input), insn(Opcode::number_mul), lit(1), insn(Opcode::number_add),
+	});
+	REQUIRE(cppush::BatchState::supports(program));
+
+	cppush::BatchState::Lanes x{0, 1, 2, 3, 4, 5, 6, 7};
+	cppush::BatchState batch;
+	batch.run(program, {x});
+
+	REQUIRE(batch.groups() == 1);
+	for (std::size_t lane = 0; lane < cppush::BatchState::lanes; ++lane) {
+		REQUIRE(batch.top_number(lane) == x[lane] * x[lane] + 1);
+	}
+}
+
+TEST_CASE("run_cases matches one State per case on random programs") {
+	std::mt19937 rng(7);
+	std::vector<std::vector<double>> cases;
+	for (int i = 0; i < 19; ++i) { // not a multiple of the lane count
+		cases.push_back({i * 0.25 - 2, 1.0 / (i + 1)});
+	}
+
+	for (int i = 0; i < 100; ++i) {
+		auto program = cppush::genome_to_program(random_genome(rng, 40));
+		if (i % 2) {
+			cppush::fuse(program);
+		}
+		auto results = cppush::run_cases(program, cases);
+
+		REQUIRE(results.size() == cases.size());
+		for (std::size_t c = 0; c < cases.size(); ++c) {
+			cppush::State state;
+			state.run(program, cases[c]);
+			auto& stack = state.get_stack<double>();
+			REQUIRE(same_number(results[c], stack.empty() ? NAN : stack.back()));
+		}
+	}
+}
+
+TEST_CASE("BatchState splits lanes at exec_if and reconverges after it") {
+	// x 3 number_lt exec_if (x 10 number_mul) (x 10 number_add) 1 number_add
+	auto program = cppush::genome_to_program({
+		insn(Opcode::input), lit(3), insn(Opcode::number_lt), insn(Opcode::exec_if),
+			insn(Opcode::input), lit(10), insn(Opcode::number_mul), close_block(),
+			insn(Opcode::input), lit(10), insn(Opcode::number_add), close_block(),
+		lit(1), insn(Opcode::number_add),
+	});
+
+	cppush::BatchState::Lanes x{0, 1, 2, 3, 4, 5, 6, 7};
+	cppush::BatchState batch;
+	batch.run(program, {x});
+
+	REQUIRE(batch.groups() == 1);
+	for (std::size_t lane = 0; lane < cppush::BatchState::lanes; ++lane) {
+		double expected = x[lane] < 3 ? x[lane] * 10 + 1 : x[lane] + 10 + 1;
+		REQUIRE(batch.top_number(lane) == expected);
+	}
+}
+
+TEST_CASE("run_cases matches one State per case on random branching programs") {
+	std::mt19937 rng(11);
+	std::vector<std::vector<double>> cases;
+	for (int i = 0; i < 21; ++i) {
+		cases.push_back({i * 0.5 - 5, std::sin(i)});
+	}
+	auto opcodes = number_instructions();
+	for (auto opcode : {Opcode::number_lt, Opcode::number_gt, Opcode::exec_if, Opcode::exec_if}) {
+		opcodes.push_back(opcode);
+	}
+
+	for (int i = 0; i < 200; ++i) {
+		auto program = cppush::genome_to_program(random_genome(rng, 40, opcodes));
+		REQUIRE(cppush::BatchState::supports(program));
+		auto results = cppush::run_cases(program, cases);
+
+		for (std::size_t c = 0; c < cases.size(); ++c) {
+			cppush::State state;
+			state.run(program, cases[c]);
+			auto& stack = state.get_stack<double>();
+			REQUIRE(same_number(results[c], stack.empty() ? NAN : stack.back()));
+		}
+	}
+}
+
+TEST_CASE("BatchState reconverges many divergent exec_ifs without deep recursion") {
+	// every exec_dup doubles how often the divergent exec_if runs, and lanes
+	// reconverge after each, so the splits must not nest on the C++ stack
+	cppush::Genome genome(16, insn(Opcode::exec_dup));
+	genome.insert(genome.end(), {
+		insn(Opcode::bool_input), insn(Opcode::exec_if), lit(1), close_block(), lit(2), close_block(),
+	});
+	genome.resize(genome.size() + 12, close_block());
+	REQUIRE(genome.size() == 34);
+	auto program = cppush::genome_to_program(genome);
+
+	std::vector<std::vector<double>> cases;
+	for (int i = 0; i < 8; ++i) {
+		cases.push_back({double(i % 2)});
+	}
+	auto results = cppush::run_cases(program, cases);
+
+	for (std::size_t c = 0; c < cases.size(); ++c) {
+		cppush::State state;
+		state.run(program, cases[c]);
+		auto& stack = state.get_stack<double>();
+		REQUIRE(same_number(results[c], stack.empty() ? NAN : stack.back()));
+	}
+}
+
+TEST_CASE("BatchState stops lanes at the effort limit like State") {
+	// 2^40 runs of a divergent exec_if without a limit
+	cppush::Genome genome(40, insn(Opcode::exec_dup));
+	genome.insert(genome.end(), {
+		insn(Opcode::bool_input), insn(Opcode::exec_if), insn(Opcode::input), close_block(), lit(2),
+	});
+	auto program = cppush::genome_to_program(genome);
+
+	std::vector<std::vector<double>> cases;
+	cppush::BatchState::Lanes x;
+	for (std::size_t i = 0; i < cppush::BatchState::lanes; ++i) {
+		cases.push_back({double(i % 2)});
+		x[i] = i % 2;
+	}
+	cppush::BatchState batch;
+	batch.set_effort_limit(1'000);
+	batch.run(program, {x});
+	auto results = cppush::run_cases(program, cases, 1'000);
+
+	for (std::size_t c = 0; c < cases.size(); ++c) {
+		cppush::State state;
+		state.set_effort_limit(1'000);
+		state.run(program, cases[c]);
+		REQUIRE(state.exhausted_effort());
+		REQUIRE(batch.cut_off(c));
+		auto& stack = state.get_stack<double>();
+		REQUIRE(same_number(batch.top_number(c), stack.empty() ? NAN : stack.back()));
+		REQUIRE(same_number(results[c], batch.top_number(c)));
+	}
+
+	// cases with different input counts run one at a time, under the same limit
+	cases.back().push_back(0);
+	results = cppush::run_cases(program, cases, 1'000);
+	REQUIRE(same_number(results[0], batch.top_number(0)));
+}
+
+TEST_CASE("BatchState charges lanes their own effort after branches of different lengths") {
+	// bool_input exec_if (1 1 number_add 1 number_add) (2) exec_dup (5 number_add):
+	// both branches leave one number, but the first charges more
+	auto program = cppush::genome_to_program({
+		insn(Opcode::bool_input), insn(Opcode::exec_if),
+		lit(1), lit(1), insn(Opcode::number_add), lit(1), insn(Opcode::number_add), close_block(),
+		lit(2), close_block(),
+		insn(Opcode::exec_dup), lit(5), insn(Opcode::number_add),
+	});
+	cppush::BatchState::Lanes x;
+	for (std::size_t i = 0; i < cppush::BatchState::lanes; ++i) {
+		x[i] = i % 2;
+	}
+
+	// without a limit the branches still reconverge
+	cppush::BatchState batch;
+	batch.run(program, {x});
+	REQUIRE(batch.groups() == 1);
+
+	for (std::size_t limit = 1; limit < 60; ++limit) {
+		batch.set_effort_limit(limit);
+		batch.run(program, {x});
+		for (std::size_t lane = 0; lane < cppush::BatchState::lanes; ++lane) {
+			cppush::State state;
+			state.set_effort_limit(limit);
+			state.run(program, {x[lane]});
+			auto& stack = state.get_stack<double>();
+			REQUIRE(batch.cut_off(lane) == state.exhausted_effort());
+			REQUIRE(same_number(batch.top_number(lane), stack.empty() ? NAN : stack.back()));
+		}
+	}
+}
@@ -0,0 +1,145 @@
+#include "cppush/bitslice.hpp"
+#include "cppush/genome.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/state.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+using cppush::Opcode;
+
+namespace {
+
+// top of the bool stack for row of the truth table, run on a State
+bool run_row(const cppush::Program& program, std::size_t inputs, std::size_t row,
+		std::size_t effort_limit = std::numeric_limits<std::size_t>::max()) {
+	std::vector<double> values;
+	for (std::size_t i = 0; i < inputs; ++i) {
+		values.push_back((row >> i) & 1);
+	}
+	cppush::State state;
+	state.set_effort_limit(effort_limit);
+	state.run(program, values);
+	const auto& stack = state.get_stack<bool>();
+	return !stack.empty() && stack.back();
+}
+
+bool table_row(const std::vector<cppush::BitsliceState::Word>& table, std::size_t row) {
+	return (table[row / 64] >> (row % 64)) & 1;
+}
+
+} // namespace
+
+TEST_CASE("Bool ops follow the legacy semantics on a State") {
+	// (a b) for each op, in row order a=0 b=0, a=1 b=0, a=0 b=1, a=1 b=1
+	std::vector<std::pair<Opcode, std::vector<bool>>> ops{
+		{Opcode::bool_and, {0, 0, 0, 1}},
+		{Opcode::bool_or, {0, 1, 1, 1}},
+		{Opcode::bool_nand, {1, 1, 1, 0}},
+		{Opcode::bool_nor, {1, 0, 0, 0}},
+		{Opcode::bool_xor, {0, 1, 1, 0}},
+		{Opcode::bool_invert_first_then_and, {0, 1, 0, 0}},
+		{Opcode::bool_invert_second_then_and, {0, 0, 1, 0}},
+	};
+	for (const auto& [opcode, expected] : ops) {
+		auto program = cppush::genome_to_program({insn(Opcode::bool_input, 0), insn(Opcode::bool_input, 1), insn(opcode)});
+		for (std::size_t row = 0; row < 4; ++row) {
+			REQUIRE(run_row(program, 2, row) == expected[row]);
+		}
+	}
+}
+
+TEST_CASE("run_truth_table evaluates the 6-multiplexer in one pass") {
+	// address bits a0 a1 select one of the data bits d0..d3 (inputs 2..5):
+	// (a1 and (a0 ? d3 : d2)) or (not a1 and (a0 ? d1 : d0))
+	auto select = [](std::uint8_t low, std::uint8_t high) {
+		// (a0 and high) or (not a0 and low)
+		return cppush::Genome{
+			insn(Opcode::bool_input, 0), insn(Opcode::bool_input, high), insn(Opcode::bool_and),
+			insn(Opcode::bool_input, 0), insn(Opcode::bool_input, low), insn(Opcode::bool_invert_second_then_and),
+			insn(Opcode::bool_or),
+		};
+	};
+	cppush::Genome genome = select(2, 3);
+	genome.push_back(insn(Opcode::bool_input, 1));
+	genome.push_back(insn(Opcode::bool_invert_first_then_and));
+	for (auto gene : select(4, 5)) {
+		genome.push_back(gene);
+	}
+	genome.push_back(insn(Opcode::bool_input, 1));
+	genome.push_back(insn(Opcode::bool_and));
+	genome.push_back(insn(Opcode::bool_or));
+	auto program = cppush::genome_to_program(genome);
+	REQUIRE(cppush::BitsliceState::supports(program));
+
+	auto table = cppush::run_truth_table(program, 6);
+	REQUIRE(table.size() == 1);
+	for (std::size_t row = 0; row < 64; ++row) {
+		std::size_t address = row & 3;
+		REQUIRE(table_row(table, row) == bool((row >> (2 + address)) & 1));
+	}
+}
+
+TEST_CASE("Truth tables past 64 rows span several words") {
+	// input 6 xor input 7
+	auto program = cppush::genome_to_program({
+		insn(Opcode::bool_input, 6), insn(Opcode::bool_input, 7), insn(Opcode::bool_xor),
+	});
+	auto table = cppush::run_truth_table(program, 8);
+	REQUIRE(table == std::vector<cppush::BitsliceState::Word>{0, ~0ull, ~0ull, 0});
+	// tables under 64 rows leave the spare bits clear
+	REQUIRE(cppush::run_truth_table(program, 2) == std::vector<cppush::BitsliceState::Word>{0});
+}
+
+TEST_CASE("Programs the bitsliced engine can't run fall back to a State") {
+	// 0 < 1 pushes true on every row
+	auto program = cppush::genome_to_program({lit(0), lit(1), insn(Opcode::number_lt)});
+	REQUIRE_FALSE(cppush::BitsliceState::supports(program));
+	REQUIRE(cppush::run_truth_table(program, 3) == std::vector<cppush::BitsliceState::Word>{0xff});
+}
+
+TEST_CASE("run_truth_table matches one State per row on random programs") {
+	std::mt19937 rng(9);
+	for (std::size_t inputs : {2, 6, 8}) {
+		for (int i = 0; i < 100; ++i) {
+			// random_genome's literals are numbers, which would force the fallback
+			cppush::Genome genome;
+			for (auto gene : random_genome(rng, 40, bool_instructions())) {
+				if (gene.type != cppush::Gene::Type::Literal) {
+					genome.push_back(gene);
+				}
+			}
+			auto program = cppush::genome_to_program(genome);
+			REQUIRE(cppush::BitsliceState::supports(program));
+			auto table = cppush::run_truth_table(program, inputs);
+			REQUIRE(table.size() == ((std::size_t(1) << inputs) + 63) / 64);
+			for (std::size_t row = 0; row < (std::size_t(1) << inputs); ++row) {
+				REQUIRE(table_row(table, row) == run_row(program, inputs, row));
+			}
+		}
+	}
+}
+
+TEST_CASE("BitsliceState stops at the effort limit like State") {
+	// 2^40 runs of (input 0) xor (input 1) without a limit
+	cppush::Genome genome(40, insn(Opcode::exec_dup));
+	genome.insert(genome.end(), {insn(Opcode::bool_input, 0), insn(Opcode::bool_input, 1), insn(Opcode::bool_xor)});
+	auto program = cppush::genome_to_program(genome);
+	REQUIRE(cppush::BitsliceState::supports(program));
+
+	cppush::BitsliceState state;
+	state.set_effort_limit(1'000);
+	state.run(program, {0xa, 0xc});
+	REQUIRE(state.cut_off());
+
+	auto table = cppush::run_truth_table(program, 2, 1'000);
+	for (std::size_t row = 0; row < 4; ++row) {
+		REQUIRE(table_row(table, row) == run_row(program, 2, row, 1'000));
+	}
+}
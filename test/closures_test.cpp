@@ -0,0 +1,142 @@
+#include "cppush/analysis.hpp"
+#include "cppush/closures.hpp"
+#include "cppush/code.hpp"
+#include "cppush/fusion.hpp"
+#include "cppush/genome.hpp"
+#include "cppush/number_ops.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+#include "cppush/state.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <memory>
+#include <random>
+#include <vector>
+
+using cppush::Opcode;
+
+namespace {
+
+// pushes a number, so a Program can be rebuilt from Code for comparison
+class PushNumber : public cppush::Code {
+public:
+	PushNumber(double value) : value(value) {}
+	unsigned operator()(cppush::State& state) override {
+		state.push<double>(value);
+		return 1;
+	}
+
+private:
+	double value;
+};
+
+// the same program as Instructions and CodeLists. only literals, blocks and
+// add/sub/mul/div are handled
+std::vector<std::shared_ptr<cppush::Code>> to_code(const cppush::Program& program, cppush::Block block) {
+	std::vector<std::shared_ptr<cppush::Code>> code;
+	for (auto i = block.begin; i < block.end; ++i) {
+		cppush::Bytecode insn = program.code[i];
+		switch (insn.opcode) {
+		case Opcode::literal:
+			code.push_back(std::make_shared<PushNumber>(program.number_pool[insn.arg]));
+			break;
+		case Opcode::block:
+			code.push_back(std::make_shared<cppush::CodeList>(to_code(program, program.blocks[insn.arg])));
+			break;
+		case Opcode::number_add:
+			code.push_back(std::make_shared<cppush::Instruction>(cppush::number_add<cppush::State>));
+			break;
+		case Opcode::number_sub:
+			code.push_back(std::make_shared<cppush::Instruction>(cppush::number_sub<cppush::State>));
+			break;
+		case Opcode::number_mul:
+			code.push_back(std::make_shared<cppush::Instruction>(cppush::number_mul<cppush::State>));
+			break;
+		case Opcode::number_div:
+			code.push_back(std::make_shared<cppush::Instruction>(cppush::number_div<cppush::State>));
+			break;
+		default:
+			break;
+		}
+	}
+	return code;
+}
+
+} // namespace
+
+TEST_CASE("ClosureProgram runs a program with exec instructions") {
+	// exec_dup (1 number_add) on 2
+	auto program = cppush::genome_to_program({
+		lit(2), insn(Opcode::exec_dup), lit(1), insn(Opcode::number_add), close_block(), lit(5),
+	});
+	cppush::ClosureProgram closures(program);
+	cppush::State push;
+	push.run(closures);
+	REQUIRE(push.get_stack<double>() == std::vector<double>{4, 5});
+}
+
+TEST_CASE("ClosureProgram matches the interpreter on random programs") {
+	std::mt19937 rng(11);
+	auto opcodes = number_instructions();
+	for (auto opcode : {Opcode::number_lt, Opcode::number_gt, Opcode::exec_if}) {
+		opcodes.push_back(opcode);
+	}
+	for (auto opcode : bool_instructions()) {
+		opcodes.push_back(opcode);
+	}
+
+	for (int i = 0; i < 300; ++i) {
+		auto program = cppush::genome_to_program(random_genome(rng, 40, opcodes));
+		if (i % 2) {
+			cppush::fuse(program);
+			cppush::elide_checks(program, 2);
+		}
+
+		cppush::State reference;
+		reference.run(program, {1.5, -2});
+		cppush::State closures;
+		closures.run(cppush::ClosureProgram(program), {1.5, -2});
+
+		auto& expected = reference.get_stack<double>();
+		auto& actual = closures.get_stack<double>();
+		REQUIRE(same_numbers(actual, expected));
+		REQUIRE(closures.get_stack<bool>() == reference.get_stack<bool>());
+	}
+}
+
+TEST_CASE("Interpreter benchmarks", "[.benchmark]") {
+	std::mt19937 rng(3);
+	cppush::Genome genome;
+	while (genome.size() < 400) {
+		for (auto gene : random_genome(rng, 40, {Opcode::number_add, Opcode::number_sub, Opcode::number_mul, Opcode::number_div})) {
+			genome.push_back(gene);
+		}
+	}
+	auto program = cppush::genome_to_program(genome);
+	auto code = to_code(program, program.blocks[0]);
+	cppush::ClosureProgram closures(program);
+
+	BENCHMARK("Instruction and CodeList") {
+		cppush::State state;
+		state.run(code);
+		return state.get_stack<double>().size();
+	};
+	BENCHMARK("dispatch table") {
+		cppush::State state;
+		state.run(program);
+		return state.get_stack<double>().size();
+	};
+	BENCHMARK("cached top") {
+		cppush::State state;
+		state.set_interpreter(cppush::State::Interpreter::cached_top);
+		state.run(program);
+		return state.get_stack<double>().size();
+	};
+	BENCHMARK("closures") {
+		cppush::State state;
+		state.run(closures);
+		return state.get_stack<double>().size();
+	};
+}
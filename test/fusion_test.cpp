@@ -0,0 +1,113 @@
+#include "cppush/fusion.hpp"
+#include "cppush/genome.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+#include "cppush/state.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <vector>
+
+namespace {
+
+using cppush::Opcode;
+
+std::vector<double> run(const cppush::Program& program, std::vector<double> inputs) {
+	cppush::State push;
+	push.run(program, inputs);
+	return push.get_stack<double>();
+}
+
+} // namespace
+
+TEST_CASE("fuse reduces dispatches without changing results") {
+	// (x * 2.5 + 1.5) * x
+	cppush::Genome genome{
+		insn(Opcode::input), lit(2.5), insn(Opcode::number_mul), lit(1.5), insn(Opcode::number_add),
+		insn(Opcode::input), insn(Opcode::number_mul),
+	};
+	auto program = cppush::genome_to_program(genome);
+	auto fused = program;
+	cppush::fuse(fused);
+
+	REQUIRE(fused.code.size() == 4);
+	REQUIRE(fused.code[1].opcode == Opcode::literal_mul);
+	for (double x : {-1.5, 0.0, 3.0}) {
+		REQUIRE(run(fused, {x}) == run(program, {x}));
+	}
+	REQUIRE(run(fused, {3}) == std::vector<double>{27});
+}
+
+TEST_CASE("fuse moves immediate literals into the pool") {
+	// ((x + 1) * 2 - 0.5) + 1.7: an integer, another, a common constant and a pool literal
+	auto program = cppush::genome_to_program({
+		insn(Opcode::input), lit(1), insn(Opcode::number_add), lit(2), insn(Opcode::number_mul),
+		lit(0.5), insn(Opcode::number_sub), lit(1.7), insn(Opcode::number_add), lit(2), insn(Opcode::number_div),
+	});
+	REQUIRE(program.code[1].opcode == Opcode::literal_int);
+	REQUIRE(program.code[5].opcode == Opcode::literal_constant);
+	auto fused = program;
+	cppush::fuse(fused);
+
+	REQUIRE(fused.code.size() == 6);
+	for (std::size_t i = 1; i < fused.code.size(); ++i) {
+		REQUIRE(fused.code[i].opcode >= Opcode::literal_add);
+		REQUIRE(fused.code[i].opcode <= Opcode::literal_mul_add);
+	}
+	// the repeated 2 shares its entry
+	REQUIRE(fused.number_pool == std::vector<double>{1.7, 1, 2, 0.5});
+	for (double x : {-1.5, 0.0, 3.0}) {
+		REQUIRE(run(fused, {x}) == run(program, {x}));
+	}
+}
+
+TEST_CASE("fuse leaves immediate literals alone once the pool is full") {
+	cppush::Program program;
+	program.code = {{Opcode::literal_int, 3}, {Opcode::number_add}};
+	program.blocks = {{0, 2}};
+	program.number_pool.resize(256, 0.25);
+	auto fused = program;
+	cppush::fuse(fused);
+
+	REQUIRE(fused.code.size() == 2);
+	REQUIRE(fused.number_pool.size() == 256);
+}
+
+TEST_CASE("fuse matches underflow behaviour of the original sequence") {
+	cppush::Genome genome{insn(Opcode::input, 1), insn(Opcode::number_mul), insn(Opcode::number_add)};
+	auto program = cppush::genome_to_program(genome);
+	auto fused = program;
+	cppush::fuse(fused);
+
+	REQUIRE(fused.code.size() == 1);
+	REQUIRE(fused.code[0].opcode == Opcode::input_mul_add);
+	REQUIRE(run(fused, {1}) == run(program, {1})); // missing input
+	REQUIRE(run(fused, {1, 2}) == run(program, {1, 2}));
+}
+
+TEST_CASE("fuse leaves instructions targeted by exec instructions alone") {
+	cppush::Program program;
+	program.code = {{Opcode::literal, 0}, {Opcode::exec_pop}, {Opcode::literal, 1}, {Opcode::number_add}};
+	program.blocks = {{0, 4}};
+	program.number_pool = {5, 1};
+	auto fused = program;
+	cppush::fuse(fused);
+
+	REQUIRE(fused.code.size() == 4);
+	REQUIRE(run(fused, {}) == std::vector<double>{5});
+}
+
+TEST_CASE("select_superinstructions ranks by profiled frequency") {
+	cppush::NgramProfile profile;
+	profile.add(cppush::genome_to_program({
+		insn(Opcode::input), insn(Opcode::number_mul), insn(Opcode::input), insn(Opcode::number_mul),
+		lit(3), insn(Opcode::number_sub),
+	}));
+
+	REQUIRE(profile.count({Opcode::input, Opcode::number_mul}) == 2);
+	// immediate literals count as literal, since they fuse the same way
+	REQUIRE(profile.count({Opcode::literal, Opcode::number_sub}) == 1);
+	REQUIRE(cppush::select_superinstructions(profile, 1) == std::vector<Opcode>{Opcode::input_mul});
+	REQUIRE(cppush::select_superinstructions(profile, 5).size() == 2);
+}
@@ -0,0 +1,84 @@
+#include "cppush/genome.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+#include "cppush/state.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using cppush::Opcode;
+
+TEST_CASE("genome_to_program lays out nested blocks contiguously") {
+	// 2 exec_dup (3 exec_dup (4 number_mul) number_add) number_sub
+	cppush::Genome genome{
+		lit(2), insn(Opcode::exec_dup),
+			lit(3), insn(Opcode::exec_dup),
+				lit(4), insn(Opcode::number_mul),
+			close_block(),
+			insn(Opcode::number_add),
+		close_block(),
+		insn(Opcode::number_sub),
+	};
+	auto program = cppush::genome_to_program(genome);
+
+	REQUIRE(program.blocks.size() == 3);
+	REQUIRE(program.code.size() == genome.size() - 2 + 2); // closes dropped, block refs added
+	REQUIRE(program.code.back().opcode == Opcode::number_sub); // main program is laid out last
+
+	auto main = program.blocks[0];
+	REQUIRE(main.end == program.code.size());
+	REQUIRE(program.code[main.begin + 2].opcode == Opcode::block);
+	REQUIRE(program.code[main.begin + 2].arg == 1);
+
+	auto inner = program.blocks[2];
+	REQUIRE(inner.end - inner.begin == 2);
+	REQUIRE(program.code[inner.begin + 1].opcode == Opcode::number_mul);
+}
+
+TEST_CASE("genome_to_program deduplicates constants") {
+	cppush::Genome genome{lit(1.5), lit(2.5), lit(1.5), lit(-1e-9), lit(1e-9)};
+	auto program = cppush::genome_to_program(genome);
+
+	REQUIRE(program.number_pool.size() == 4);
+	REQUIRE(program.code[0].arg == program.code[2].arg);
+	REQUIRE(program.code[3].arg != program.code[4].arg);
+}
+
+TEST_CASE("genome_to_program encodes small integers and common constants in the instruction") {
+	cppush::Genome genome{lit(-128), lit(127), lit(0.0), lit(-0.0), lit(0.5), lit(128), lit(0.75)};
+	auto program = cppush::genome_to_program(genome);
+
+	std::vector<Opcode> expected{
+		Opcode::literal_int, Opcode::literal_int, Opcode::literal_int, Opcode::literal_constant,
+		Opcode::literal_constant, Opcode::literal, Opcode::literal,
+	};
+	REQUIRE(program.code.size() == expected.size());
+	for (std::size_t i = 0; i < expected.size(); ++i) {
+		REQUIRE(program.code[i].opcode == expected[i]);
+	}
+	REQUIRE(program.number_pool == std::vector<double>{128, 0.75});
+
+	cppush::State state;
+	state.run(program);
+	const auto& stack = state.get_stack<double>();
+	REQUIRE(stack == std::vector<double>{-128, 127, 0, 0, 0.5, 128, 0.75});
+	REQUIRE(!std::signbit(stack[2]));
+	REQUIRE(std::signbit(stack[3]));
+}
+
+TEST_CASE("genome_to_program balances parentheses") {
+	// 3 exec_dup (2 number_mul -- block never closed; stray close is ignored
+	cppush::Genome genome{close_block(), lit(3), insn(Opcode::exec_dup), lit(2), insn(Opcode::number_mul)};
+	auto program = cppush::genome_to_program(genome);
+
+	cppush::State push;
+	push.run(program);
+
+	auto& number_stack = push.get_stack<double>();
+	REQUIRE(number_stack.size() == 1);
+	REQUIRE(number_stack.at(0) == 12);
+}
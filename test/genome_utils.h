@@ -0,0 +1,70 @@
+#ifndef GENOME_UTILS_H
+#define GENOME_UTILS_H
+
+#include "cppush/genome.hpp"
+#include "cppush/opcode.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <vector>
+
+inline cppush::Gene insn(cppush::Opcode opcode, std::uint8_t arg = 0) {
+	return {cppush::Gene::Type::Instruction, {opcode, arg}};
+}
+inline cppush::Gene lit(double value) { return {cppush::Gene::Type::Literal, {}, value}; }
+inline cppush::Gene close_block() { return {cppush::Gene::Type::Close}; }
+
+// instructions that work on any number of inputs and the number stack
+inline std::vector<cppush::Opcode> number_instructions() {
+	std::vector<cppush::Opcode> opcodes;
+	for (auto op = cppush::Opcode::input; op <= cppush::Opcode::number_tan; op = cppush::Opcode(int(op) + 1)) {
+		opcodes.push_back(op);
+	}
+	return opcodes;
+}
+
+// instructions that run bitsliced: bool inputs and ops plus data independent control flow
+inline std::vector<cppush::Opcode> bool_instructions() {
+	std::vector<cppush::Opcode> opcodes{cppush::Opcode::bool_input, cppush::Opcode::exec_dup, cppush::Opcode::exec_pop};
+	for (auto op = cppush::Opcode::bool_and; op <= cppush::Opcode::bool_invert_second_then_and; op = cppush::Opcode(int(op) + 1)) {
+		opcodes.push_back(op);
+	}
+	return opcodes;
+}
+
+// genome of random instructions (with arg 0 or 1), small literals and closes
+inline cppush::Genome random_genome(std::mt19937& rng, int size, const std::vector<cppush::Opcode>& opcodes = number_instructions()) {
+	std::uniform_int_distribution<std::size_t> opcode(0, opcodes.size() - 1);
+	std::uniform_int_distribution<int> kind(0, 9);
+	const double common[] = {-0.0, 0.5, 3.141592653589793, 0.1, 2, 1.5, 0.25, -0.5, 0.75, 1};
+	cppush::Genome genome;
+	for (int i = 0; i < size; ++i) {
+		int k = kind(rng);
+		if (k == 0) {
+			genome.push_back(close_block());
+		} else if (k < 4) {
+			// a mix of immediate ints, pool entries and common constants
+			int value = kind(rng);
+			genome.push_back(lit(k == 1 ? value : k == 2 ? value + 0.125 : common[value]));
+		} else {
+			genome.push_back(insn(opcodes[opcode(rng)], k % 2));
+		}
+	}
+	return genome;
+}
+
+// equal, treating NaNs as equal too
+inline bool same_number(double a, double b) {
+	return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+// same length and same_number at every index, e.g. two number stacks
+template <typename A, typename B>
+bool same_numbers(const A& a, const B& b) {
+	return std::equal(std::begin(a), std::end(a), std::begin(b), std::end(b), same_number);
+}
+
+#endif // GENOME_UTILS_H
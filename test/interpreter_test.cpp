@@ -0,0 +1,194 @@
+#include "cppush/analysis.hpp"
+#include "cppush/fusion.hpp"
+#include "cppush/genome.hpp"
+#include "cppush/interpreter.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/program.hpp"
+#include "cppush/stacks.hpp"
+#include "cppush/state.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+using cppush::Opcode;
+
+namespace {
+
+using Arithmetic = cppush::Interpreter<Opcode::input, Opcode::number_add, Opcode::number_sub, Opcode::number_mul, Opcode::number_div>;
+
+// every instruction random genomes, fusion and elide_checks can produce
+template <template <typename...> class Storage>
+using EverythingIn = cppush::BasicInterpreter<Storage,
+	Opcode::input, Opcode::bool_input, Opcode::exec_dup, Opcode::exec_if, Opcode::exec_pop,
+	Opcode::number_add, Opcode::number_sub, Opcode::number_mul, Opcode::number_div, Opcode::number_mod,
+	Opcode::number_max, Opcode::number_min, Opcode::number_cos, Opcode::number_sin, Opcode::number_tan,
+	Opcode::number_lt, Opcode::number_gt,
+	Opcode::bool_and, Opcode::bool_or, Opcode::bool_not, Opcode::bool_nand, Opcode::bool_nor, Opcode::bool_xor,
+	Opcode::bool_invert_first_then_and, Opcode::bool_invert_second_then_and,
+	Opcode::literal_add, Opcode::literal_sub, Opcode::literal_mul, Opcode::literal_div, Opcode::literal_mul_add,
+	Opcode::input_add, Opcode::input_sub, Opcode::input_mul, Opcode::input_div, Opcode::input_mul_add,
+	Opcode::number_add_unchecked, Opcode::number_sub_unchecked, Opcode::number_mul_unchecked,
+	Opcode::number_div_unchecked, Opcode::number_mod_unchecked, Opcode::number_max_unchecked,
+	Opcode::number_min_unchecked, Opcode::number_cos_unchecked, Opcode::number_sin_unchecked,
+	Opcode::number_tan_unchecked>;
+using Everything = EverythingIn<cppush::Stacks>;
+
+// only the stacks the instructions use
+static_assert(Arithmetic::has_numbers && !Arithmetic::has_bools);
+static_assert(!cppush::Interpreter<Opcode::bool_input, Opcode::bool_xor>::has_numbers);
+static_assert(Everything::has_bools);
+static_assert(std::is_same_v<cppush::StacksFor<cppush::Stacks, cppush::stack::number | cppush::stack::exec>, cppush::Stacks<double>>);
+static_assert(!cppush::Stacks<double, bool>::contains<cppush::Exec>);
+
+} // namespace
+
+TEST_CASE("Interpreter runs a program over its instruction set") {
+	// (x + 2) * x
+	auto program = cppush::genome_to_program({
+		insn(Opcode::input), lit(2), insn(Opcode::number_add), insn(Opcode::input), insn(Opcode::number_mul),
+	});
+	REQUIRE(Arithmetic::supports(program));
+
+	Arithmetic interpreter;
+	interpreter.run(program, {3});
+	REQUIRE(interpreter.get_stack<double>() == std::vector<double>{15});
+}
+
+TEST_CASE("Interpreter rejects opcodes outside its instruction set") {
+	auto program = cppush::genome_to_program({lit(2), insn(Opcode::number_sin)});
+	REQUIRE_FALSE(Arithmetic::supports(program));
+
+	Arithmetic interpreter;
+	REQUIRE_THROWS_AS(interpreter.run(program), std::invalid_argument);
+}
+
+TEST_CASE("Interpreter matches State on random programs") {
+	std::mt19937 rng(19);
+	auto opcodes = number_instructions();
+	for (auto opcode : {Opcode::number_lt, Opcode::number_gt, Opcode::exec_if}) {
+		opcodes.push_back(opcode);
+	}
+	for (auto opcode : bool_instructions()) {
+		opcodes.push_back(opcode);
+	}
+
+	for (int i = 0; i < 300; ++i) {
+		auto program = cppush::genome_to_program(random_genome(rng, 40, opcodes));
+		if (i % 2) {
+			cppush::fuse(program);
+			cppush::elide_checks(program, 2);
+		}
+		REQUIRE(Everything::supports(program));
+
+		cppush::State reference;
+		reference.run(program, {1.5, -2});
+		Everything interpreter;
+		interpreter.run(program, {1.5, -2});
+		EverythingIn<cppush::SlabStacks> slab;
+		slab.run(program, {1.5, -2});
+
+		auto& expected = reference.get_stack<double>();
+		auto& actual = interpreter.get_stack<double>();
+		REQUIRE(same_numbers(actual, expected));
+		REQUIRE(interpreter.get_stack<bool>() == reference.get_stack<bool>());
+
+		auto& slab_numbers = slab.get_stack<double>();
+		REQUIRE(same_numbers(slab_numbers, expected));
+		REQUIRE(slab.get_stack<bool>() == reference.get_stack<bool>());
+	}
+}
+
+TEST_CASE("SlabStacks share one allocation and drop pushes past capacity") {
+	cppush::SlabStacks<double, bool> stacks(4);
+	auto& numbers = stacks.get<double>();
+	auto& bools = stacks.get<bool>();
+	for (int i = 0; i < 6; ++i) {
+		numbers.push_back(i);
+	}
+	bools.push_back(true);
+	REQUIRE(numbers == std::vector<double>{0, 1, 2, 3});
+	REQUIRE(bools == std::vector<bool>{true});
+	// the bool stack follows the number stack's region
+	REQUIRE(reinterpret_cast<const unsigned char*>(bools.begin()) - reinterpret_cast<const unsigned char*>(numbers.begin()) == 32);
+
+	stacks.clear();
+	REQUIRE(numbers.empty());
+	REQUIRE(bools.empty());
+	REQUIRE(numbers.capacity() == 4);
+}
+
+TEST_CASE("Copies of an interpreter have their own stacks") {
+	auto program = cppush::genome_to_program({lit(2), insn(Opcode::input), insn(Opcode::number_mul)});
+	using SlabArithmetic = cppush::SlabInterpreter<Opcode::input, Opcode::number_add, Opcode::number_sub, Opcode::number_mul, Opcode::number_div>;
+	static_assert(!std::is_constructible_v<Arithmetic, std::size_t>, "only slab storage takes a capacity");
+
+	Arithmetic interpreter;
+	interpreter.run(program, {3});
+	Arithmetic copy(interpreter);
+	copy.run(program, {5});
+	REQUIRE(interpreter.get_stack<double>() == std::vector<double>{6});
+	REQUIRE(copy.get_stack<double>() == std::vector<double>{6, 10});
+
+	SlabArithmetic slab(4);
+	slab.run(program, {3});
+	SlabArithmetic slab_copy(slab);
+	slab_copy.run(program, {5});
+	REQUIRE(slab.get_stack<double>() == std::vector<double>{6});
+	REQUIRE(slab_copy.get_stack<double>() == std::vector<double>{6, 10});
+	REQUIRE(slab_copy.get_stack<double>().capacity() == 4);
+
+	slab = slab_copy;
+	REQUIRE(slab.get_stack<double>() == std::vector<double>{6, 10});
+	REQUIRE(slab.get_stack<double>().begin() != slab_copy.get_stack<double>().begin());
+}
+
+TEST_CASE("Interpreter stops at the effort limit like State") {
+	// 2^40 additions without a limit
+	cppush::Genome genome(40, insn(Opcode::exec_dup));
+	genome.insert(genome.end(), {lit(1), insn(Opcode::number_add)});
+	auto program = cppush::genome_to_program(genome);
+
+	cppush::State reference;
+	reference.set_effort_limit(1'000);
+	reference.run(program);
+	cppush::Interpreter<Opcode::exec_dup, Opcode::number_add> interpreter;
+	interpreter.set_effort_limit(1'000);
+	interpreter.run(program);
+
+	REQUIRE(interpreter.cut_off());
+	REQUIRE(interpreter.get_effort() == reference.get_effort());
+	REQUIRE(interpreter.get_stack<double>() == reference.get_stack<double>());
+}
+
+TEST_CASE("Specialised interpreter benchmark", "[.benchmark]") {
+	std::mt19937 rng(3);
+	cppush::Genome genome;
+	while (genome.size() < 400) {
+		for (auto gene : random_genome(rng, 40, {Opcode::number_add, Opcode::number_sub, Opcode::number_mul, Opcode::number_div})) {
+			genome.push_back(gene);
+		}
+	}
+	auto program = cppush::genome_to_program(genome);
+
+	BENCHMARK("dispatch table") {
+		cppush::State state;
+		state.run(program);
+		return state.get_stack<double>().size();
+	};
+	BENCHMARK("specialised") {
+		Arithmetic interpreter;
+		interpreter.run(program);
+		return interpreter.get_stack<double>().size();
+	};
+	BENCHMARK("specialised, slab stacks") {
+		cppush::SlabInterpreter<Opcode::input, Opcode::number_add, Opcode::number_sub, Opcode::number_mul, Opcode::number_div> interpreter(512);
+		interpreter.run(program);
+		return interpreter.get_stack<double>().size();
+	};
+}
@@ -0,0 +1,76 @@
+#include "cppush/analysis.hpp"
+#include "cppush/fusion.hpp"
+#include "cppush/genome.hpp"
+#include "cppush/jit.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/state.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using cppush::Opcode;
+
+TEST_CASE("NativeProgram computes a number program") {
+	// x * x + 1
+	auto program = cppush::genome_to_program({
+		insn(Opcode::input), insn(Opcode::input), insn(Opcode::number_mul), lit(1), insn(Opcode::number_add),
+	});
+	if (!cppush::NativeProgram::supports(program)) {
+		SUCCEED("no jit on this platform");
+		return;
+	}
+	cppush::NativeProgram native(program, 1);
+	for (double x : {-2.0, 0.0, 3.5}) {
+		REQUIRE(native(&x) == x * x + 1);
+	}
+
+	// an empty stack gives NaN
+	cppush::NativeProgram empty(cppush::genome_to_program({insn(Opcode::number_add)}), 0);
+	REQUIRE(std::isnan(empty.function()(nullptr)));
+}
+
+TEST_CASE("NativeProgram rejects programs with exec instructions") {
+	auto program = cppush::genome_to_program({insn(Opcode::exec_dup), lit(1)});
+	REQUIRE_FALSE(cppush::NativeProgram::supports(program));
+	REQUIRE_THROWS_AS(cppush::NativeProgram(program, 0), std::invalid_argument);
+}
+
+TEST_CASE("NativeProgram matches State on random programs") {
+	std::mt19937 rng(5);
+	// number_instructions() minus the bool and exec ones
+	std::vector<Opcode> opcodes{Opcode::input};
+	for (auto op = Opcode::number_add; op <= Opcode::number_gt; op = Opcode(int(op) + 1)) {
+		opcodes.push_back(op);
+	}
+	const std::vector<std::vector<double>> cases{{1.5, -2}, {0, 0}, {-0.0, 3}, {1e300, 1e-300}};
+
+	for (int i = 0; i < 300; ++i) {
+		auto program = cppush::genome_to_program(random_genome(rng, 40, opcodes));
+		if (i % 2) {
+			cppush::fuse(program);
+			cppush::elide_checks(program, 2);
+		}
+		if (!cppush::NativeProgram::supports(program)) {
+			SUCCEED("no jit on this platform");
+			return;
+		}
+		cppush::NativeProgram native(program, 2);
+
+		for (const auto& inputs : cases) {
+			cppush::State state;
+			state.run(program, inputs);
+			auto& stack = state.get_stack<double>();
+			double expected = stack.empty() ? std::numeric_limits<double>::quiet_NaN() : stack.back();
+			double actual = native(inputs.data());
+			REQUIRE(same_number(actual, expected));
+			if (!std::isnan(expected)) {
+				REQUIRE(std::signbit(actual) == std::signbit(expected));
+			}
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#include "cppush/instruction_set.hpp"
+#include "cppush/opcode.hpp"
+
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using cppush::Opcode;
+
+TEST_CASE("find_opcode finds every opcode by name") {
+	for (std::size_t i = 0; i < cppush::opcode_count; ++i) {
+		auto opcode = static_cast<Opcode>(i);
+		REQUIRE(cppush::find_opcode(cppush::opcode_name(opcode)) == opcode);
+	}
+	REQUIRE(cppush::opcode_name(Opcode::number_add) == "number_add");
+
+	for (std::string name : {"", "number", "number_add_", "Number_add", "count", "float_add"}) {
+		REQUIRE_FALSE(cppush::find_opcode(name).has_value());
+	}
+}
+
+TEST_CASE("InstructionSet registers names in bulk") {
+	cppush::InstructionSet set{{"input", "number_add", "number_mul", "number_add"}};
+	REQUIRE(set.get_opcodes() == std::vector<Opcode>{Opcode::input, Opcode::number_add, Opcode::number_mul});
+	REQUIRE(set.get_opcode("number_mul") == Opcode::number_mul);
+	REQUIRE(set.contains(Opcode::input));
+	REQUIRE_FALSE(set.contains(Opcode::number_sub));
+
+	// known opcode, but not registered
+	REQUIRE_THROWS_AS(set.get_opcode("number_sub"), std::invalid_argument);
+
+	// an unknown name rejects the whole batch
+	REQUIRE_THROWS_AS(set.add({"number_sub", "float_add"}), std::invalid_argument);
+	REQUIRE_FALSE(set.contains(Opcode::number_sub));
+}
+
+TEST_CASE("register_core_by_stack only takes instructions on the given stacks") {
+	auto number = cppush::register_core_by_stack(cppush::stack::number);
+	REQUIRE(number.contains(Opcode::input));
+	REQUIRE(number.contains(Opcode::number_tan));
+	// needs the boolean stack too
+	REQUIRE_FALSE(number.contains(Opcode::number_lt));
+	REQUIRE_FALSE(number.contains(Opcode::exec_dup));
+	// made by translation, never drawn for a genome
+	REQUIRE_FALSE(number.contains(Opcode::literal));
+	REQUIRE_FALSE(number.contains(Opcode::input_add));
+	REQUIRE_FALSE(number.contains(Opcode::number_add_unchecked));
+
+	auto core = cppush::register_core();
+	for (auto opcode : core.get_opcodes()) {
+		REQUIRE(cppush::instruction_info(opcode).core);
+	}
+	REQUIRE(core.contains(Opcode::exec_if));
+	REQUIRE(core.contains(Opcode::number_lt));
+	REQUIRE(core.contains(Opcode::bool_input));
+}
@@ -0,0 +1,242 @@
+#include "cppush/genome.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/pushgp.hpp"
+#include "cppush/regression.hpp"
+#include "cppush/state.hpp"
+#include "cppush/tiering.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+using cppush::Opcode;
+
+namespace {
+
+cppush::PushGPConfig regression_config() {
+	cppush::PushGPConfig config;
+	config.instruction_set = {
+		{Opcode::input, 0}, {Opcode::number_add}, {Opcode::number_sub}, {Opcode::number_mul}, {Opcode::number_div},
+	};
+	config.literal_set = {1};
+	config.erc_generators = {[](std::mt19937& rng) { return std::uniform_int_distribution<>(-5, 5)(rng); }};
+	config.population_size = 100;
+	config.initial_genome_size = 10;
+	return config;
+}
+
+// every program has the same error on every case
+class Unsolvable : public cppush::PushGP {
+public:
+	Unsolvable(cppush::PushGPConfig config, double error) : PushGP(std::move(config), 0), error(error) {}
+
+	void fit(int gens) { train(gens); }
+
+protected:
+	std::size_t num_fitness_cases() const override { return 2; }
+	std::size_t num_inputs() const override { return 1; }
+	double evaluate(cppush::TieredProgram&, cppush::State&, std::size_t) const override { return error; }
+
+private:
+	double error;
+};
+
+// runs each program once per case, on a population set by the test
+class Scripted : public cppush::PushGP {
+public:
+	Scripted(cppush::PushGPConfig config) : PushGP(std::move(config), 0) {}
+
+	void set_population(const std::vector<cppush::Genome>& genomes) {
+		population.clear();
+		for (const auto& genome : genomes) {
+			population.push_back({genome, std::make_shared<cppush::TieredProgram>(cppush::genome_to_program(genome))});
+		}
+	}
+	void evaluate() { evaluate_population(); }
+	void next() { next_generation(); }
+	std::vector<std::size_t> groups() const { return group_programs(); }
+	std::size_t effort(std::size_t index) const { return population[index].effort; }
+	double& error(std::size_t index) { return population[index].error; }
+
+protected:
+	std::size_t num_fitness_cases() const override { return 4; }
+	std::size_t num_inputs() const override { return 1; }
+	double evaluate(cppush::TieredProgram& program, cppush::State& state, std::size_t) const override {
+		return program.run(state, {1});
+	}
+};
+
+} // namespace
+
+TEST_CASE("TieredProgram gives the same results on every tier") {
+	std::mt19937 rng(13);
+	auto opcodes = number_instructions();
+	opcodes.push_back(Opcode::exec_if);
+	opcodes.push_back(Opcode::number_lt);
+
+	cppush::State state;
+	for (int i = 0; i < 100; ++i) {
+		auto program = cppush::genome_to_program(random_genome(rng, 30, opcodes));
+		cppush::TieredProgram interpreted(program);
+		cppush::TieredProgram compiled(program);
+		compiled.promote(2);
+		REQUIRE(compiled.get_tier() != cppush::Tier::interpreter);
+
+		for (const std::vector<double>& inputs : {std::vector<double>{1.5, -2}, {0.25}, {}}) {
+			REQUIRE(same_number(compiled.run(state, inputs), interpreted.run(state, inputs)));
+		}
+		REQUIRE(compiled.get_runs() == 3);
+	}
+}
+
+TEST_CASE("TieredProgram runs on a reused State as on a fresh one") {
+	std::mt19937 rng(17);
+	auto opcodes = number_instructions();
+	opcodes.push_back(Opcode::exec_if);
+	opcodes.push_back(Opcode::number_lt);
+
+	cppush::State state;
+	for (int i = 0; i < 100; ++i) {
+		cppush::TieredProgram program(cppush::genome_to_program(random_genome(rng, 30, opcodes)));
+		if (i % 2) {
+			program.promote(1);
+		}
+		for (const std::vector<double>& inputs : {std::vector<double>{1.5, -2}, {0.25}}) {
+			cppush::State fresh;
+			REQUIRE(same_number(program.run(state, inputs), program.run(fresh, inputs)));
+		}
+	}
+}
+
+TEST_CASE("FloatRegression finds x + 1") {
+	cppush::FloatRegression gp{regression_config(), 0};
+
+	std::vector<double> inputs, outputs;
+	for (double i = -10; i < 10; i += 0.5) {
+		inputs.push_back(i);
+		outputs.push_back(i + 1);
+	}
+	gp.fit(inputs, outputs, 20);
+
+	REQUIRE(gp.get_best_score() == 0);
+	for (double i = -20; i < -10; i += 0.5) {
+		REQUIRE(gp.predict(i) == i + 1);
+	}
+}
+
+TEST_CASE("PushGP keeps a best when no error is finite") {
+	for (double error : {INFINITY, NAN}) {
+		Unsolvable gp{regression_config(), error};
+		gp.fit(2);
+
+		REQUIRE(same_number(gp.get_best_score(), error));
+		REQUIRE_NOTHROW(gp.get_best());
+	}
+}
+
+TEST_CASE("PushGP gives the same results on any number of threads") {
+	std::vector<double> inputs, outputs;
+	for (double i = -5; i < 5; i += 0.25) {
+		inputs.push_back(i);
+		outputs.push_back(i * i - 3);
+	}
+
+	// tiles of one case each up to every case in one tile. errors are summed
+	// per tile, so the tile size can change rounding but threads can't
+	for (std::size_t cache_bytes : {1, 64, 1 << 20}) {
+		auto config = regression_config();
+		config.cache_bytes = cache_bytes;
+		config.threads = 1;
+		cppush::FloatRegression serial{config, 7};
+		serial.fit(inputs, outputs, 5);
+
+		config.threads = 2 + cache_bytes % 3;
+		cppush::FloatRegression parallel{config, 7};
+		parallel.fit(inputs, outputs, 5);
+
+		REQUIRE(parallel.get_best_score() == serial.get_best_score());
+		for (double input : {-7.5, 0.0, 2.25}) {
+			REQUIRE(same_number(parallel.predict(input), serial.predict(input)));
+		}
+	}
+}
+
+TEST_CASE("PushGP promotes surviving elites to a compiled tier") {
+	auto config = regression_config();
+	config.tiering.promote_after_generations = 1;
+	cppush::FloatRegression gp{config, 1};
+	gp.fit({1, 2, 3}, {3, 5, 7}, 5);
+
+	const auto& stats = gp.get_tier_stats();
+	REQUIRE(stats.promotions > 0);
+	REQUIRE(stats.runs[std::size_t(cppush::Tier::interpreter)] > 0);
+	REQUIRE(stats.runs[std::size_t(cppush::Tier::closures)] + stats.runs[std::size_t(cppush::Tier::native)] > 0);
+
+	// with tiering off everything stays on the interpreter
+	config.tiering.enabled = false;
+	cppush::FloatRegression interpreted{config, 1};
+	interpreted.fit({1, 2, 3}, {3, 5, 7}, 5);
+	const auto& off = interpreted.get_tier_stats();
+	REQUIRE(off.runs[std::size_t(cppush::Tier::closures)] + off.runs[std::size_t(cppush::Tier::native)] == 0);
+	REQUIRE(off.promotions == 1); // the final best, for predict
+}
+
+TEST_CASE("PushGP groups individuals by the effort they last took") {
+	// a short program that does far more work than its length suggests
+	cppush::Genome expensive(12, insn(Opcode::exec_dup));
+	expensive.push_back(lit(1));
+	std::vector<cppush::Genome> genomes{expensive};
+	for (int i = 0; i < 63; ++i) {
+		genomes.push_back(cppush::Genome(30, lit(i)));
+	}
+
+	auto config = regression_config();
+	config.threads = 1;
+	config.tiering.enabled = false;
+	Scripted gp{config};
+	gp.set_population(genomes);
+	// unevaluated, cost is estimated from length, so the first group is shared
+	REQUIRE(gp.groups()[1] > 1);
+
+	gp.evaluate();
+	REQUIRE(gp.effort(0) > 100 * gp.effort(1));
+	REQUIRE(gp.groups()[1] == 1);
+}
+
+TEST_CASE("PushGP ranks NaN errors last when choosing elites") {
+	auto config = regression_config();
+	config.threads = 1;
+	config.elite_count = 5;
+	Scripted gp{config};
+	gp.set_population(std::vector<cppush::Genome>(20, cppush::Genome{lit(1)}));
+	// every other individual has a NaN error
+	for (std::size_t i = 0; i < 20; ++i) {
+		gp.error(i) = i % 2 ? double(20 - i) : NAN;
+	}
+	gp.next();
+
+	for (std::size_t i = 0; i < 5; ++i) {
+		REQUIRE(gp.error(i) == double(1 + 2 * i));
+	}
+}
+
+TEST_CASE("TieredProgram runs within its State's effort limit") {
+	// 2^40 literals without a limit, on every tier
+	cppush::Genome genome(40, insn(Opcode::exec_dup));
+	genome.push_back(lit(1));
+	cppush::TieredProgram program(cppush::genome_to_program(genome));
+
+	cppush::State state;
+	state.set_effort_limit(1'000);
+	program.run(state, {});
+	REQUIRE(state.exhausted_effort());
+	program.promote(0);
+	program.run(state, {});
+	REQUIRE(state.exhausted_effort());
+}
@@ -0,0 +1,85 @@
+#include "cppush/analysis.hpp"
+#include "cppush/fusion.hpp"
+#include "cppush/genome.hpp"
+#include "cppush/opcode.hpp"
+#include "cppush/registers.hpp"
+#include "cppush/state.hpp"
+
+#include "genome_utils.h"
+
+#include <catch2/catch.hpp>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using cppush::Opcode;
+using Op = cppush::RegisterProgram::Op;
+
+TEST_CASE("RegisterProgram shares common subexpressions") {
+	auto program = cppush::genome_to_program({
+		insn(Opcode::input), insn(Opcode::input), insn(Opcode::number_mul),
+		insn(Opcode::exec_dup), close_block(), // not straight-line
+	});
+	REQUIRE_THROWS_AS(cppush::RegisterProgram(program, 1), std::invalid_argument);
+
+	// x * x + x * x
+	cppush::Genome genome{
+		insn(Opcode::input), insn(Opcode::input), insn(Opcode::number_mul),
+		insn(Opcode::input), insn(Opcode::input), insn(Opcode::number_mul),
+		insn(Opcode::number_add),
+	};
+	cppush::RegisterProgram registers(cppush::genome_to_program(genome), 1);
+	const auto& code = registers.get_code();
+	REQUIRE(code.size() == 3);
+	REQUIRE(code[0].op == Op::input);
+	REQUIRE(code[1].op == Op::mul);
+	REQUIRE(code[2].op == Op::add);
+	REQUIRE(code[2].a == 1);
+	REQUIRE(code[2].b == 1);
+
+	double x = 3;
+	REQUIRE(registers.run(&x) == 18);
+}
+
+TEST_CASE("RegisterProgram drops values that don't reach the final stack") {
+	// (1 + 2) < 4 leaves only x * 2
+	auto program = cppush::genome_to_program({
+		insn(Opcode::input), lit(2), insn(Opcode::number_mul),
+		lit(1), lit(2), insn(Opcode::number_add), lit(4), insn(Opcode::number_lt),
+	});
+	cppush::RegisterProgram registers(program, 1);
+	REQUIRE(registers.get_code().size() == 3); // input, 2, mul
+	REQUIRE(registers.get_stack().size() == 1);
+
+	double x = 5;
+	REQUIRE(registers.run(&x) == 10);
+}
+
+TEST_CASE("RegisterProgram matches State's number stack on random programs") {
+	std::mt19937 rng(17);
+	std::vector<Opcode> opcodes{Opcode::input};
+	for (auto op = Opcode::number_add; op <= Opcode::number_gt; op = Opcode(int(op) + 1)) {
+		opcodes.push_back(op);
+	}
+	const std::vector<double> inputs{1.5, -2};
+
+	std::vector<double> values;
+	for (int i = 0; i < 300; ++i) {
+		auto program = cppush::genome_to_program(random_genome(rng, 40, opcodes));
+		if (i % 2) {
+			cppush::fuse(program);
+			cppush::elide_checks(program, 2);
+		}
+		cppush::RegisterProgram registers(program, inputs.size());
+		registers.run(inputs.data(), values);
+
+		cppush::State state;
+		state.run(program, inputs);
+		const auto& expected = state.get_stack<double>();
+		std::vector<double> actual;
+		for (auto reg : registers.get_stack()) {
+			actual.push_back(values[reg]);
+		}
+		REQUIRE(same_numbers(actual, expected));
+	}
+}
@@ -1,14 +1,26 @@
+#include "cppush/analysis.hpp"
+#include "cppush/closures.hpp"
 #include "cppush/code.hpp"
+#include "cppush/fusion.hpp"
+#include "cppush/genome.hpp"
 #include "cppush/number_ops.hpp"
+#include "cppush/program.hpp"
 #include "cppush/state.hpp"
 
+#include "genome_utils.h"
+
 #include <catch2/catch.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <memory>
+#include <random>
+#include <vector>
 
 TEST_CASE("Run number_add with (1 2 3) number stack") {
 	cppush::State push;
 
-	auto add = std::make_shared<cppush::Instruction>(cppush::number_add);
+	auto add = std::make_shared<cppush::Instruction>(cppush::number_add<cppush::State>);
 	std::vector<std::shared_ptr<cppush::Code>> program {add, add};
 	push.push<double>(3);
 	push.push<double>(2);
@@ -18,4 +30,296 @@ TEST_CASE("Run number_add with (1 2 3) number stack") {
 	auto& number_stack = push.get_stack<double>();
 	REQUIRE(number_stack.size() == 1);
 	REQUIRE(number_stack.at(0) == 6);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Run Program with literals and a nested block") {
+	using cppush::Opcode;
+	cppush::State push;
+
+	cppush::Program program;
+	program.code = {
+		{Opcode::literal, 0}, {Opcode::block, 1}, {Opcode::number_mul},
+		{Opcode::literal, 1}, {Opcode::literal, 1}, {Opcode::number_add},
+	};
+	program.blocks = {{0, 3}, {3, 6}};
+	program.number_pool = {3, 2};
+	push.run(program);
+
+	auto& number_stack = push.get_stack<double>();
+	REQUIRE(number_stack.size() == 1);
+	REQUIRE(number_stack.at(0) == 12);
+}
+
+TEST_CASE("exec_dup runs the next block twice") {
+	using cppush::Opcode;
+	cppush::State push;
+
+	cppush::Program program;
+	program.code = {
+		{Opcode::exec_dup}, {Opcode::block, 1},
+		{Opcode::literal, 0}, {Opcode::number_mul},
+	};
+	program.blocks = {{0, 2}, {2, 4}};
+	program.number_pool = {2};
+	push.push<double>(3);
+	push.run(program);
+
+	auto& number_stack = push.get_stack<double>();
+	REQUIRE(number_stack.size() == 1);
+	REQUIRE(number_stack.at(0) == 12);
+}
+
+TEST_CASE("exec_pop skips the next item of the enclosing block") {
+	using cppush::Opcode;
+	cppush::State push;
+
+	cppush::Program program;
+	program.code = {
+		{Opcode::block, 1}, {Opcode::literal, 0}, {Opcode::literal, 1},
+		{Opcode::exec_pop},
+	};
+	program.blocks = {{0, 3}, {3, 4}};
+	program.number_pool = {1, 2};
+	push.run(program);
+
+	auto& number_stack = push.get_stack<double>();
+	REQUIRE(number_stack.size() == 1);
+	REQUIRE(number_stack.at(0) == 2);
+}
+
+TEST_CASE("Interpreters and program passes agree on random programs") {
+	using cppush::Opcode;
+
+	std::mt19937 rng(1);
+	auto opcodes = number_instructions();
+	for (auto opcode : {Opcode::number_lt, Opcode::number_gt, Opcode::exec_if}) {
+		opcodes.push_back(opcode);
+	}
+	for (auto opcode : bool_instructions()) {
+		opcodes.push_back(opcode);
+	}
+
+	for (int i = 0; i < 300; ++i) {
+		auto genome = random_genome(rng, 40, i < 100 ? number_instructions() : opcodes);
+		auto plain = cppush::genome_to_program(genome);
+		auto program = plain;
+		if (i % 2) {
+			cppush::fuse(program);
+			cppush::elide_checks(program, 2);
+		}
+
+		cppush::State table;
+		table.run(program, {1.5, -2});
+		cppush::State cached;
+		cached.set_interpreter(cppush::State::Interpreter::cached_top);
+		cached.run(program, {1.5, -2});
+
+		cppush::State reference;
+		reference.run(plain, {1.5, -2});
+
+		auto& expected = reference.get_stack<double>();
+		for (auto* state : {&table, &cached}) {
+			auto& actual = state->get_stack<double>();
+			REQUIRE(same_numbers(actual, expected));
+		}
+	}
+}
+
+TEST_CASE("States with other stacks agree with State") {
+	using cppush::Opcode;
+
+	std::mt19937 rng(2);
+	auto opcodes = number_instructions();
+	for (auto opcode : {Opcode::number_lt, Opcode::number_gt, Opcode::exec_if}) {
+		opcodes.push_back(opcode);
+	}
+	for (auto opcode : bool_instructions()) {
+		opcodes.push_back(opcode);
+	}
+
+	// a state without a bool stack only matches on programs that don't use one
+	auto number_opcodes = number_instructions();
+	number_opcodes.erase(std::remove_if(number_opcodes.begin(), number_opcodes.end(), [](Opcode opcode) {
+		return opcode == Opcode::bool_input || opcode == Opcode::exec_if;
+	}), number_opcodes.end());
+
+	for (int i = 0; i < 200; ++i) {
+		bool numbers_only = i < 100;
+		auto program = cppush::genome_to_program(random_genome(rng, 40, numbers_only ? number_opcodes : opcodes));
+
+		cppush::State reference;
+		reference.run(program, {1.5, -2});
+		cppush::SlabState<double, bool> slab(4'096);
+		slab.run(program, {1.5, -2});
+		REQUIRE(same_numbers(slab.get_stack<double>(), reference.get_stack<double>()));
+		REQUIRE(slab.get_stack<bool>() == reference.get_stack<bool>());
+
+		if (numbers_only) {
+			cppush::BasicState<cppush::Stacks, double> numbers;
+			numbers.set_interpreter(decltype(numbers)::Interpreter::cached_top);
+			numbers.run(program, {1.5, -2});
+			REQUIRE(same_numbers(numbers.get_stack<double>(), reference.get_stack<double>()));
+		}
+	}
+}
+
+TEST_CASE("Elided checks stay in bounds on a full slab stack") {
+	using cppush::Opcode;
+
+	// 1 2 3 number_add number_add number_add, the first two adds unchecked
+	auto program = cppush::genome_to_program({
+		lit(1), lit(2), lit(3), insn(Opcode::number_add), insn(Opcode::number_add), insn(Opcode::number_add),
+	});
+	cppush::elide_checks(program);
+	REQUIRE(program.code[4].opcode == Opcode::number_add_unchecked);
+	static_assert(cppush::SlabState<double>::drops_pushes && !cppush::State::drops_pushes);
+
+	// 3 is dropped, so the second unchecked add finds one number and does nothing
+	cppush::SlabState<double> state(2);
+	state.run(program);
+	REQUIRE(state.get_stack<double>() == std::vector<double>{3});
+}
+
+TEST_CASE("Instructions on a stack the state doesn't have are noops") {
+	using cppush::Opcode;
+
+	// 1 2 number_lt bool_not 3 exec_if (10) (20)
+	auto program = cppush::genome_to_program({
+		lit(1), lit(2), insn(Opcode::number_lt), insn(Opcode::bool_not), lit(3),
+		insn(Opcode::exec_if), lit(10), close_block(), lit(20),
+	});
+	cppush::BasicState<cppush::Stacks, double> numbers;
+	numbers.run(program);
+
+	REQUIRE(numbers.get_stack<double>() == std::vector<double>{3, 10, 20});
+	REQUIRE(numbers.get_stack<bool>().empty());
+}
+
+TEST_CASE("exec_if runs one of the next two items") {
+	using cppush::Opcode;
+
+	// 1 2 number_lt exec_if (10) (20)
+	auto program = cppush::genome_to_program({
+		lit(1), lit(2), insn(Opcode::number_lt), insn(Opcode::exec_if), lit(10), close_block(), lit(20),
+	});
+	cppush::State push;
+	push.run(program);
+
+	REQUIRE(push.get_stack<double>() == std::vector<double>{10});
+	REQUIRE(push.get_stack<bool>().empty());
+
+	// without a bool it's a noop and both items run
+	cppush::State no_bool;
+	no_bool.run(cppush::genome_to_program({insn(Opcode::exec_if), lit(10), close_block(), lit(20)}));
+	REQUIRE(no_bool.get_stack<double>() == std::vector<double>{10, 20});
+}
+
+TEST_CASE("reset empties the stacks but keeps their capacity") {
+	using cppush::Opcode;
+
+	auto program = cppush::genome_to_program({
+		insn(Opcode::input), lit(2), insn(Opcode::number_lt), lit(3), lit(4), lit(5),
+	});
+	cppush::State push;
+	push.run(program, {1});
+	REQUIRE(push.get_stack<double>() == std::vector<double>{3, 4, 5});
+	const double* numbers = push.get_stack<double>().data();
+	auto capacity = push.get_stack<double>().capacity();
+
+	push.reset();
+	REQUIRE(push.get_stack<double>().empty());
+	REQUIRE(push.get_stack<bool>().empty());
+	REQUIRE(push.get_stack<double>().capacity() == capacity);
+
+	// a second run reuses the same memory, and inputs from the first are gone
+	push.run(program);
+	REQUIRE(push.get_stack<double>() == std::vector<double>{2, 3, 4, 5});
+	REQUIRE(push.get_stack<double>().data() == numbers);
+}
+
+TEST_CASE("The effort limit cuts off runaway programs") {
+	using cppush::Opcode;
+
+	// exec_dup doubles the work of everything after it: 2^40 literals
+	cppush::Genome genome;
+	for (int i = 0; i < 40; ++i) {
+		genome.push_back(insn(Opcode::exec_dup));
+	}
+	genome.push_back(lit(1));
+	auto program = cppush::genome_to_program(genome);
+
+	cppush::State push;
+	push.set_effort_limit(1'000);
+	push.run(program);
+	REQUIRE(push.exhausted_effort());
+	REQUIRE(push.get_stack<double>().size() < 1'000);
+
+	// blocks are charged in full when entered: 3 for the main block, 1 for
+	// the exec_dup copy, then 1 each time the block runs
+	cppush::State small;
+	small.set_effort_limit(1'000);
+	small.run(cppush::genome_to_program({lit(1), insn(Opcode::exec_dup), lit(2), close_block()}));
+	REQUIRE_FALSE(small.exhausted_effort());
+	REQUIRE(small.get_effort() == 6);
+	REQUIRE(small.get_stack<double>() == std::vector<double>{1, 2, 2});
+}
+
+TEST_CASE("Every interpreter cuts a run off at the same point") {
+	std::mt19937 rng(23);
+	auto opcodes = number_instructions();
+	opcodes.push_back(cppush::Opcode::exec_if);
+	opcodes.push_back(cppush::Opcode::number_lt);
+
+	for (int i = 0; i < 300; ++i) {
+		auto program = cppush::genome_to_program(random_genome(rng, 40, opcodes));
+		std::size_t limit = 10 + i % 50;
+
+		cppush::State reference;
+		reference.set_effort_limit(limit);
+		reference.run(program, {1.5, -2});
+
+		cppush::State cached;
+		cached.set_effort_limit(limit);
+		cached.set_interpreter(cppush::State::Interpreter::cached_top);
+		cached.run(program, {1.5, -2});
+
+		cppush::State closures;
+		closures.set_effort_limit(limit);
+		closures.run(cppush::ClosureProgram(program), {1.5, -2});
+
+		auto& expected = reference.get_stack<double>();
+		for (auto* state : {&cached, &closures}) {
+			auto& actual = state->get_stack<double>();
+			REQUIRE(same_numbers(actual, expected));
+			REQUIRE(state->get_effort() == reference.get_effort());
+			REQUIRE(state->exhausted_effort() == reference.exhausted_effort());
+		}
+	}
+}
+
+TEST_CASE("The time limit stops runs the effort limit doesn't") {
+	using cppush::Opcode;
+
+	cppush::Genome genome;
+	for (int i = 0; i < 60; ++i) {
+		genome.push_back(insn(Opcode::exec_dup));
+	}
+	genome.push_back(lit(1));
+	genome.push_back(insn(Opcode::exec_pop));
+	auto program = cppush::genome_to_program(genome);
+
+	cppush::State push;
+	push.set_time_limit(std::chrono::milliseconds(5));
+	auto start = std::chrono::steady_clock::now();
+	push.run(program);
+	REQUIRE(push.timed_out());
+	REQUIRE_FALSE(push.exhausted_effort());
+
+	push.run(cppush::ClosureProgram(program));
+	REQUIRE(push.timed_out());
+	REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+
+	// a quick run doesn't time out
+	push.run(cppush::genome_to_program({lit(1), lit(2), insn(Opcode::number_add)}));
+	REQUIRE_FALSE(push.timed_out());
+}
@@ -0,0 +1,67 @@
+#include "cppush/thread_pool.hpp"
+
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("ThreadPool runs every index once") {
+	for (unsigned workers : {1u, 2u, 5u}) {
+		cppush::ThreadPool pool(workers);
+		REQUIRE(pool.size() == workers);
+
+		for (std::size_t count : {0, 1, 3, 1'000}) {
+			std::vector<std::atomic<int>> calls(count);
+			std::vector<std::atomic<int>> busy(workers);
+			std::atomic<bool> overlapped{false};
+			pool.run(count, [&](std::size_t index, unsigned worker) {
+				if (busy[worker]++ != 0) {
+					overlapped = true;
+				}
+				++calls[index];
+				--busy[worker];
+			});
+			for (auto& call : calls) {
+				REQUIRE(call == 1);
+			}
+			REQUIRE_FALSE(overlapped);
+		}
+	}
+}
+
+TEST_CASE("ThreadPool steals from workers with slow indices") {
+	cppush::ThreadPool pool(4);
+	// the first worker's share is all slow. the others finish theirs, then steal
+	std::vector<unsigned> ran_on(40);
+	pool.run(ran_on.size(), [&](std::size_t index, unsigned worker) {
+		if (index < 10) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+		ran_on[index] = worker;
+	});
+	std::size_t stolen = 0;
+	for (std::size_t index = 0; index < 10; ++index) {
+		stolen += ran_on[index] != 0;
+	}
+	REQUIRE(stolen > 0);
+}
+
+TEST_CASE("ThreadPool rethrows after finishing the loop") {
+	cppush::ThreadPool pool(3);
+	std::atomic<int> calls{0};
+	REQUIRE_THROWS_AS(pool.run(100, [&](std::size_t index, unsigned) {
+		++calls;
+		if (index == 7) {
+			throw std::runtime_error("index 7");
+		}
+	}), std::runtime_error);
+	REQUIRE(calls == 100);
+
+	// and is still usable
+	calls = 0;
+	pool.run(10, [&](std::size_t, unsigned) { ++calls; });
+	REQUIRE(calls == 10);
+}